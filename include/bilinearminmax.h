@@ -2,6 +2,8 @@
 #define BILINEARMINMAX_H
 
 #include <array>
+#include <cstddef>
+#include <memory>
 
 struct Point { double p[3]; };
 
@@ -15,14 +17,70 @@ struct CombinedStrategyPoint {
     Point p {};
 };
 
+// Remembers which support (pair of rows and pair of columns, or full support)
+// was optimal the last time a given stage game was solved.
+struct SupportHint {
+    int support = -1;
+};
+
+struct SolveStats {
+    size_t pureSolves = 0;
+    size_t hintHits = 0;
+    size_t hintMisses = 0;
+
+    SolveStats& operator+=(const SolveStats& other) {
+        pureSolves += other.pureSolves;
+        hintHits += other.hintHits;
+        hintMisses += other.hintMisses;
+        return *this;
+    }
+
+    double hitRate() const {
+        size_t total = hintHits + hintMisses;
+        return total == 0 ? 0.0 : (double)hintHits / total;
+    }
+};
+
+struct SimplexSolver;
+
+// Everything a solve may write to: the preallocated GLPK problem and the statistics.
+// Solves are reentrant as long as concurrent callers use distinct contexts,
+// either owned by the caller or the one returned by forThisThread().
+class SolverContext {
+public:
+    SolverContext();
+    ~SolverContext();
+    SolverContext(const SolverContext&) = delete;
+    SolverContext& operator=(const SolverContext&) = delete;
+
+    static SolverContext& forThisThread();
+
+    SolveStats stats;
+
+private:
+    friend class BilinearMinMax;
+    std::unique_ptr<SimplexSolver> simplex_;
+};
 
 class BilinearMinMax {
 private:
-    static StrategyPoint solveBetter(const std::array<std::array<double, 3>, 3>& A);
-    static StrategyPoint solveFast(const std::array<std::array<double, 3>, 3>& A);
+    static StrategyPoint solveBetter(const std::array<std::array<double, 3>, 3>& A, SolverContext& context);
+    static StrategyPoint solveFast(const std::array<std::array<double, 3>, 3>& A, int* support = nullptr);
+    static bool solveWithSupport(const std::array<std::array<double, 3>, 3>& A, int support, StrategyPoint* solution, Point* columnStrategy = nullptr);
 public:
     static StrategyPoint solve(const std::array<std::array<double, 3>, 3>& A);
+
+    // Tries the support stored in the hint first and only enumerates all supports
+    // when the hinted one cannot be certified optimal. The hint is updated in place.
+    static StrategyPoint solve(const std::array<std::array<double, 3>, 3>& A, SolverContext& context, SupportHint* hint = nullptr);
+
+    // Returns false when no support of size 1, 2 or 3 certifies optimality (degenerate games).
+    // On success also gives the strategy of the column player.
+    static bool solveCertified(const std::array<std::array<double, 3>, 3>& A, StrategyPoint* solution, Point* columnStrategy);
+
+    // Solves the linear program with GLPK instead of enumerating supports.
+    static StrategyPoint solveExact(const std::array<std::array<double, 3>, 3>& A, SolverContext& context);
 };
 
 
-#endif
\ No newline at end of file
+#endif
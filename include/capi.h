@@ -6,6 +6,8 @@ extern "C" {
     struct JBRules;
     struct JBPlayer;
     struct JBPlayerState;
+    struct JBVecEnv;
+    struct JBPlayerFuture;
 
     enum JBPlayerType : int {
         RANDOM,
@@ -26,6 +28,20 @@ extern "C" {
         INVALID_PLAYER = -2,
         INVALID_STATE = -3,
         INVALID_ACTION = -4,
+        INVALID_ARGUMENT = -5,
+    };
+
+    // Plain player state, for callers keeping states in their own arrays
+    struct JBState {
+        int lives;
+        int bullets;
+        int remainingShields;
+    };
+
+    struct JBMatchResult {
+        int winsA;
+        int winsB;
+        int ties;
     };
 
     JBRules* jb_createRules(int startLives, int maxBullets, int maxShields, int maxTurns);
@@ -34,6 +50,44 @@ extern "C" {
     JBPlayer* jb_createPlayer(JBPlayerType type, JBRules* rules, int seed);
     void jb_destroyPlayer(JBPlayer* player);
 
+    // Limits of a player construction, 0 for the defaults of jb_createPlayer
+    struct JBBudget {
+        int games;       // QLEARNER warm-up games against a random player (100000)
+        int iterations;  // SHAPLEY sweeps of the value iteration (300)
+        double seconds;  // wall time (none); construction stops there and keeps what it reached
+    };
+
+    enum JBFutureStatus : int {
+        FUTURE_RUNNING,
+        FUTURE_READY,
+        FUTURE_FAILED,
+        FUTURE_CANCELLED,
+    };
+
+    struct JBProgress {
+        JBFutureStatus status;
+        long long steps;   // games played (QLEARNER) or sweeps done (SHAPLEY)
+        long long budget;  // steps allowed
+        double residual;   // SHAPLEY: l1 residual of the last sweep
+        double seconds;    // since the construction started, or its duration once ended
+    };
+
+    // Constructs a player on a background thread and returns at once. budget may be null.
+    // The rules are copied. Destroying the future cancels and waits for the construction.
+    JBPlayerFuture* jb_createPlayerAsync(JBPlayerType type, JBRules* rules, int seed, const JBBudget* budget);
+    void jb_destroyFuture(JBPlayerFuture* future);
+
+    JBError jb_futureProgress(JBPlayerFuture* future, JBProgress* progress);
+
+    // Waits until the construction ends or timeoutSeconds pass, forever when negative
+    JBError jb_futureWait(JBPlayerFuture* future, double timeoutSeconds, JBFutureStatus* status);
+
+    // Stops a running construction, which then ends as FUTURE_CANCELLED without a player
+    JBError jb_futureCancel(JBPlayerFuture* future);
+
+    // The constructed player once FUTURE_READY, handed over to the caller the first time only
+    JBPlayer* jb_futureTakePlayer(JBPlayerFuture* future);
+
     JBPlayerState* jb_createState(int lives, int bullets, int remainingShields);
     void jb_destroyState(JBPlayerState* state);
 
@@ -44,7 +98,115 @@ extern "C" {
     JBError jb_play(JBPlayer* player, JBPlayerState* ownState, JBPlayerState* opponentState, JBRules* rules, JBAction* action);
 
     JBError jb_applyActions(JBPlayer* playerA, JBPlayer* playerB, JBPlayerState* stateA, JBPlayerState* stateB, JBAction actionA, JBAction actionB);
-    
+
+    // Same as jb_play and jb_applyActions on plain states, without allocation.
+    // The player decides with its own rules.
+    JBError jb_playState(JBPlayer* player, JBState ownState, JBState opponentState, JBAction* action);
+    JBError jb_applyActionsToStates(JBRules* rules, JBState* stateA, JBState* stateB, JBAction actionA, JBAction actionB);
+
+    // Plays a number of complete games between playerA and playerB, from the start state of their rules.
+    // A player that is allowed to learn does so after every game, from its recording.
+    // turns may be null, otherwise it receives the number of turns of each game.
+    JBError jb_playGames(JBPlayer* playerA, JBPlayer* playerB, int games, int allowLearningA, int allowLearningB, JBMatchResult* result, int* turns);
+
+    // Number of ints per game in the observations of a JBVecEnv and of a JBPolicyCallback:
+    // own lives, bullets, remaining shields, then the opponent's
+    enum { JB_OBSERVATION_SIZE = 6 };
+
+    // Same as jb_playGames with up to batch games played side by side, so that each player
+    // decides for all of them in one call per turn
+    JBError jb_playGamesLockstep(JBPlayer* playerA, JBPlayer* playerB, int games, int batch, int allowLearningA, int allowLearningB, JBMatchResult* result, int* turns);
+
+    // Policy of a foreign player: fills actions[i] from the i-th observation, i < count.
+    // Called on the thread playing the player, with buffers owned by the library.
+    typedef void (*JBPolicyCallback)(void* userData, const int* observations, int count, JBAction* actions);
+
+    // Player deciding through policy, which is called once per batch of decisions by
+    // jb_playGamesLockstep and jb_vecEnvStep. userData is passed back untouched.
+    JBPlayer* jb_createForeignPlayer(JBRules* rules, JBPolicyCallback policy, void* userData);
+
+    // Holds envs games in which the caller plays A against opponent, which must outlive the environment.
+    // The rules must be the opponent's. The opponent decides for all the games at once.
+    JBVecEnv* jb_createVecEnv(JBRules* rules, JBPlayer* opponent, int envs);
+    void jb_destroyVecEnv(JBVecEnv* env);
+
+    // Restarts every game. observations holds envs*JB_OBSERVATION_SIZE ints.
+    JBError jb_vecEnvReset(JBVecEnv* env, int* observations);
+
+    // Plays one turn of every game with actions[i] for game i. rewards[i] is +1 when the caller wins
+    // game i on this turn, -1 when it loses and 0 otherwise; dones[i] is 1 when game i ended,
+    // in which case it is restarted and observations describe the new game.
+    // An illegal action loses the game, as in GameState::resolve.
+    JBError jb_vecEnvStep(JBVecEnv* env, const JBAction* actions, int* observations, float* rewards, int* dones);
+
+    enum JBScalarType : int {
+        FLOAT32,
+        FLOAT64,
+        INT32,
+        UINT64,
+    };
+
+    // Read-only strided view of a table owned by a player, valid while the player lives.
+    // Strides are in bytes, as NumPy's.
+    struct JBTableView {
+        const void* data;
+        JBScalarType type;
+        int ndim;
+        long long shape[2];
+        long long strides[2];
+    };
+
+    enum JBQTable : int {
+        QSCORE,
+        QCONFIDENCE,
+    };
+
+    // Scores or visit counts of a QLEARNER player for one action, shape (216, 216) indexed by
+    // [opponent][own] with index = lives + 6*bullets + 36*remainingShields. Learning updates them in place.
+    JBError jb_qlearnerTable(JBPlayer* player, JBAction action, JBQTable table, JBTableView* view);
+
+    enum JBShapleyTable : int {
+        SHAPLEY_VALUES,      // (nodes) mean payoff of the player in each state
+        SHAPLEY_THRESHOLDS,  // (nodes, 3) cumulative probabilities of reload, shield, shoot
+        SHAPLEY_STATES,      // (words) bitmap of the states, see ShapleyPlayer::Tables
+    };
+
+    // Tables of a solved SHAPLEY player. Node i is the state of the i-th set bit of SHAPLEY_STATES;
+    // decoding its position needs the bounds.
+    JBError jb_shapleyTable(JBPlayer* player, JBShapleyTable table, JBTableView* view);
+    JBError jb_shapleyBounds(JBPlayer* player, int* maxLives, int* maxBullets, int* maxShields);
+
+    // Same order as Counter in counters.h
+    enum JBCounter : int {
+        COUNTER_TURNS_SIMULATED,
+        COUNTER_GAMES_WON_A,
+        COUNTER_GAMES_WON_B,
+        COUNTER_GAMES_TIED,
+        COUNTER_GAMES_AT_TURN_LIMIT,
+        COUNTER_PURE_SOLVES,
+        COUNTER_MIXED_SOLVES,
+        COUNTER_TRANSPOSITION_HITS,
+        COUNTER_TRANSPOSITION_MISSES,
+        COUNTER_POLICY_HITS,
+        COUNTER_POLICY_MISSES,
+        COUNTER_POLICY_FILE_HITS,
+        COUNTER_POLICY_FILE_MISSES,
+        COUNTER_RECORDINGS_REPLAYED,
+    };
+
+    enum { JB_NB_COUNTERS = 14 };
+
+    // Non-zero when the library counts, i.e. was built with JAMESBOND_COUNTERS; otherwise every counter reads 0.
+    int jb_countersEnabled();
+
+    // Sums over all threads since the last reset, values[c] for c < min(count, JB_NB_COUNTERS).
+    // In a vector environment the agent is player A.
+    JBError jb_readCounters(unsigned long long* values, int count);
+    void jb_resetCounters();
+
+    // Name of a counter, null when out of range
+    const char* jb_counterName(JBCounter counter);
+
 
 }
 
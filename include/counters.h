@@ -0,0 +1,60 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hot-path event counters, compiled in only when JAMESBOND_COUNTERS is defined
+// (cmake -DJAMESBOND_COUNTERS=ON). Otherwise Counters::add is empty and reads give zeros.
+enum class Counter : int {
+    TurnsSimulated,
+    GamesWonA,
+    GamesWonB,
+    GamesTied,
+    GamesAtTurnLimit,     // also counted in one of the three above
+    PureSolves,           // stage games with a saddle point
+    MixedSolves,
+    TranspositionHits,    // BilinearPlayer search
+    TranspositionMisses,
+    PolicyHits,           // precomputed strategy of a BilinearPlayer or a ShapleyPlayer
+    PolicyMisses,
+    PolicyFileHits,       // ShapleyPlayer loaded from its cache file
+    PolicyFileMisses,
+    RecordingsReplayed,
+};
+
+constexpr int NB_COUNTERS = (int)Counter::RecordingsReplayed + 1;
+
+using CounterValues = std::array<uint64_t, NB_COUNTERS>;
+
+// Every thread increments counters of its own, without synchronization. snapshot() sums them
+// over the running threads and the ones that exited, minus their sum at the last reset().
+class Counters {
+public:
+#ifdef JAMESBOND_COUNTERS
+    static constexpr bool enabled = true;
+
+    static void add(Counter counter, uint64_t n) {
+        // Only this thread writes, readers may see the value of an increment late but never torn
+        std::atomic<uint64_t>& value = (*local())[(int)counter];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+#else
+    static constexpr bool enabled = false;
+
+    static void add(Counter, uint64_t) { }
+#endif
+
+    static void add(Counter counter) { add(counter, 1); }
+
+    static CounterValues snapshot();
+    static void reset();
+    static const char* name(Counter counter);
+
+private:
+    using Block = std::array<std::atomic<uint64_t>, NB_COUNTERS>;
+    static Block* local();
+};
+
+#endif
@@ -11,10 +11,22 @@ public:
     
     const Player* play(Player* a, Player* b, GameRecording* recording);
 
+    // Steps shared by every loop that plays games, one at a time or side by side.
+    // playTurn resolves one turn and counts it in *turns; false once the game is over or at rules.maxTurns.
+    static bool playTurn(GameState* state, int* turns, Action actionA, Action actionB, const Rules& rules);
+    // Counts an ended game in the hot-path counters and returns its GameState::outcome,
+    // or with players, its winner a, b or nullptr for a tie.
+    static int endGame(const GameState& state, int turns);
+    static const Player* endGame(const GameState& state, int turns, const Player* a, const Player* b);
+
     void replay(const GameRecording& recording) const;
 
+    // Turns played by the last call to play
+    int turns() const { return turns_; }
+
 protected:
     GameState state_;
+    int turns_ = 0;
 };
 
 #endif
\ No newline at end of file
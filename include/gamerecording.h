@@ -1,6 +1,7 @@
 #ifndef GAMERECORDING_H
 #define GAMERECORDING_H
 
+#include "counters.h"
 #include "player.h"
 #include "gamestate.h"
 #include <vector>
@@ -26,6 +27,7 @@ public:
     template<typename Callback>
     void replay(Callback&& callback) const {
         assert(a_->rules() == b_->rules());
+        Counters::add(Counter::RecordingsReplayed);
         GameState replayState;
         size_t turn = 0;
         while(!replayState.gameOver() && turn < actionsA_.size()) {
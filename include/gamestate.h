@@ -152,21 +152,30 @@ public:
         return GameStateSnapshot{stateA(), stateB()};
     }
 
+    // +1 when A wins, -1 when B wins, 0 for a tie. A game stopped before its end is decided by tieBreak.
+    int outcome() const {
+        if(!gameOver()) return tieBreak();
+        return (stateA_.lives() > 0) - (stateB_.lives() > 0);
+    }
+
+    // Lives, then bullets, then remaining shields
+    int tieBreak() const {
+        if(stateA_.lives() != stateB_.lives()) return stateA_.lives() > stateB_.lives() ? 1 : -1;
+        if(stateA_.bullets() != stateB_.bullets()) return stateA_.bullets() > stateB_.bullets() ? 1 : -1;
+        if(stateA_.remainingShields() != stateB_.remainingShields()) return stateA_.remainingShields() > stateB_.remainingShields() ? 1 : -1;
+        return 0;
+    }
+
     const Player* winner(const Player* a, const Player* b) const {
-        if(!gameOver()) return breakTie(a, b);
-        if(stateA_.lives() > 0) return a;
-        if(stateB_.lives() > 0) return b;
-        return nullptr;
+        return fromOutcome(outcome(), a, b);
     }
 
     const Player* breakTie(const Player* a, const Player* b) const {
-        if(stateA_.lives() > stateB_.lives()) return a;
-        if(stateB_.lives() > stateA_.lives()) return b;
-        if(stateA_.bullets() > stateB_.bullets()) return a;
-        if(stateB_.bullets() > stateA_.bullets()) return b;
-        if(stateA_.remainingShields() > stateB_.remainingShields()) return a;
-        if(stateB_.remainingShields() > stateA_.remainingShields()) return b;
-        return nullptr;
+        return fromOutcome(tieBreak(), a, b);
+    }
+
+    static const Player* fromOutcome(int outcome, const Player* a, const Player* b) {
+        return outcome > 0 ? a : outcome < 0 ? b : nullptr;
     }
 
     const PlayerState& stateA() const { return stateA_; }
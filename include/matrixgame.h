@@ -0,0 +1,90 @@
+#ifndef MATRIXGAME_H
+#define MATRIXGAME_H
+
+#include "bilinearminmax.h"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Zero-sum matrix games of arbitrary size. As in BilinearMinMax, A[i][j] is the cost
+// paid by the row player (minimizer) to the column player (maximizer).
+
+static constexpr int DYNAMIC_SIZE = -1;
+
+template<int M, int N>
+struct MatrixGameSolution {
+    double value = 0.0;
+    std::array<double, M> rowStrategy {};
+    std::array<double, N> columnStrategy {};
+};
+
+template<>
+struct MatrixGameSolution<DYNAMIC_SIZE, DYNAMIC_SIZE> {
+    double value = 0.0;
+    std::vector<double> rowStrategy;
+    std::vector<double> columnStrategy;
+};
+
+// Size-agnostic kernels working on a row-major m x n matrix.
+// The tableau must hold tableauSize(m, n) doubles and the basis m ints.
+class MatrixGame {
+public:
+    static size_t tableauSize(int m, int n) { return (size_t)(m+1)*(m+n+1); }
+
+    static void solve(const double* A, int m, int n, double* x, double* y, double* value, double* tableau, int* basis);
+
+    static bool solvePure(const double* A, int m, int n, double* x, double* y, double* value);
+    static void solve2x2(const double* A, double* x, double* y, double* value);
+    static double solveSimplex(const double* A, int m, int n, double* x, double* y, double* tableau, int* basis);
+};
+
+template<int M, int N>
+class MatrixGameSolver {
+    static_assert(M > 0 && N > 0, "matrix games need at least one action per player");
+public:
+    using Matrix = std::array<std::array<double, N>, M>;
+    using Solution = MatrixGameSolution<M, N>;
+
+    Solution solve(const Matrix& A) {
+        Solution solution;
+        if constexpr(M == 3 && N == 3) {
+            StrategyPoint rowSolution;
+            Point columnStrategy;
+            if(BilinearMinMax::solveCertified(A, &rowSolution, &columnStrategy)) {
+                solution.value = rowSolution.value;
+                for(int i = 0; i < 3; ++i) {
+                    solution.rowStrategy[i] = rowSolution.p.p[i];
+                    solution.columnStrategy[i] = columnStrategy.p[i];
+                }
+                return solution;
+            }
+        }
+        for(int i = 0; i < M; ++i) {
+            for(int j = 0; j < N; ++j) {
+                flat_[i*N+j] = A[i][j];
+            }
+        }
+        MatrixGame::solve(flat_.data(), M, N, solution.rowStrategy.data(), solution.columnStrategy.data(), &solution.value, tableau_.data(), basis_.data());
+        return solution;
+    }
+
+private:
+    std::array<double, M*N> flat_;
+    std::array<double, (M+1)*(M+N+1)> tableau_;
+    std::array<int, M> basis_;
+};
+
+template<>
+class MatrixGameSolver<DYNAMIC_SIZE, DYNAMIC_SIZE> {
+public:
+    using Solution = MatrixGameSolution<DYNAMIC_SIZE, DYNAMIC_SIZE>;
+
+    // A holds m rows of n entries each
+    Solution solve(const std::vector<double>& A, int m, int n);
+
+private:
+    std::vector<double> tableau_;
+    std::vector<int> basis_;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define PLAYER_H
 
 #include "gamestate.h"
+#include <cstddef>
 
 class GameRecording;
 
@@ -13,6 +14,12 @@ public:
     virtual Action nextAction(const PlayerState& myState, const PlayerState& opponentState) = 0;
     virtual void learnFromGame(const GameRecording& recording) = 0;
 
+    // Decisions of independent games, in order. Players asking an outside policy override it
+    // to make one request per batch.
+    virtual void nextActions(const PlayerState* myStates, const PlayerState* opponentStates, Action* actions, size_t count) {
+        for(size_t i = 0; i < count; ++i) actions[i] = nextAction(myStates[i], opponentStates[i]);
+    }
+
     const Rules& rules() const { return rules_; }
 
 protected:
@@ -3,17 +3,102 @@
 
 #include "player.h"
 #include "rand.h"
+#include "bilinearminmax.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Mixed strategy of the bilinear player for every pair of live player states.
+// It only depends on the Rules, so players with the same Rules share one table.
+class BilinearPolicy {
+public:
+    // Returns nullptr when the table would be too large, players then solve every move.
+    static std::shared_ptr<const BilinearPolicy> forRules(const Rules& rules);
+
+    static Point computeStrategy(const Rules& rules, const PlayerState& myState, const PlayerState& opponentState);
+
+    // Returns nullptr for states outside of the table (dead or out of the rules' bounds)
+    const Point* lookup(const PlayerState& myState, const PlayerState& opponentState) const {
+        int me = stateIndex(myState);
+        int opponent = stateIndex(opponentState);
+        if(me < 0 || opponent < 0) return nullptr;
+        return &strategies_[(size_t)me*statesPerPlayer_ + opponent];
+    }
+
+    explicit BilinearPolicy(const Rules& rules);
+
+private:
+    int stateIndex(const PlayerState& s) const {
+        if(s.lives() < 1 || s.lives() > maxLives_) return -1;
+        if(s.bullets() < 0 || s.bullets() > maxBullets_) return -1;
+        if(s.remainingShields() < 0 || s.remainingShields() > maxShields_) return -1;
+        return ((s.lives()-1)*(maxBullets_+1) + s.bullets())*(maxShields_+1) + s.remainingShields();
+    }
+
+    // Games start from the default PlayerState whatever the Rules, so the bounds cover both
+    static int maxLives(const Rules& rules) { return std::max(rules.startLives, PlayerState().lives()); }
+    static int maxShields(const Rules& rules) { return std::max(rules.maxShields, PlayerState().remainingShields()); }
+
+    int maxLives_;
+    int maxBullets_;
+    int maxShields_;
+    int statesPerPlayer_;
+    std::vector<Point> strategies_;
+};
 
 class BilinearPlayer : public Player {
 public:
-    explicit BilinearPlayer(const Rules& rules, int seed) : Player(rules), rand_(seed) { }
+    struct Params {
+        // Turns looked ahead: 1 plays the one-turn policy, deeper searches back up the values
+        // of the stage games of the successors, depth-1 first.
+        int depth = 1;
+        // Seconds per move, 0 for none. When it runs out the deepest completed search is played.
+        double timeBudget = 0.0;
+        // Size of the transposition table, rounded up to a power of two (at least 2)
+        size_t transpositionEntries = 1 << 16;
+    };
+
+    explicit BilinearPlayer(const Rules& rules, int seed) : BilinearPlayer(rules, seed, Params{}) { }
+    explicit BilinearPlayer(const Rules& rules, int seed, const Params& params);
 
     Action nextAction(const PlayerState& myState, const PlayerState& opponentState) override;
 
     void learnFromGame(const GameRecording&) override { }
 
+    // Mixed strategy nextAction draws from, after the search of params.depth turns
+    Point searchStrategy(const PlayerState& myState, const PlayerState& opponentState);
+
+    // What the last searchStrategy did
+    struct SearchStats {
+        int depth = 1;                 // deepest completed search, the one played
+        size_t nodes = 0;              // states searched below the root
+        size_t transpositionHits = 0;
+    };
+
+    const SearchStats& lastSearch() const { return lastSearch_; }
+
 private:
+    // Searched value of a state at a depth, kept between moves and games since it only
+    // depends on the Rules. depth 0 marks an empty entry.
+    struct TranspositionEntry {
+        uint64_t key = 0;
+        int depth = 0;
+        double value = 0.0;
+    };
+
+    StrategyPoint solveStage(const GameState& s, int depth);
+    double searchValue(const GameState& s, int depth);
+
     mutable Rand rand_;
+    std::shared_ptr<const BilinearPolicy> policy_;
+    Params params_;
+    std::vector<TranspositionEntry> transpositions_;
+    std::chrono::steady_clock::time_point deadline_;
+    size_t searchedNodes_ = 0;
+    bool aborted_ = false;
+    SearchStats lastSearch_;
 };
 
-#endif
\ No newline at end of file
+#endif
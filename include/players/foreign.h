@@ -0,0 +1,33 @@
+#ifndef FOREIGN_H
+#define FOREIGN_H
+
+#include "player.h"
+#include <functional>
+
+// Player whose decisions come from outside the library, typically a policy in another
+// language reached through the C API. Its policy answers a whole batch of decisions per
+// call, so playing it in lockstep (Tourney::play2v2Lockstep) pays the call once per turn.
+class ForeignPlayer : public Player {
+public:
+    // Fills actions[i] for myStates[i] against opponentStates[i], i < count
+    using Policy = std::function<void(const PlayerState* myStates, const PlayerState* opponentStates, Action* actions, size_t count)>;
+
+    explicit ForeignPlayer(const Rules& rules, Policy policy) : Player(rules), policy_(std::move(policy)) { }
+
+    Action nextAction(const PlayerState& myState, const PlayerState& opponentState) override {
+        Action action = Action::Reload;
+        policy_(&myState, &opponentState, &action, 1);
+        return action;
+    }
+
+    void nextActions(const PlayerState* myStates, const PlayerState* opponentStates, Action* actions, size_t count) override {
+        policy_(myStates, opponentStates, actions, count);
+    }
+
+    void learnFromGame(const GameRecording&) override { }
+
+private:
+    Policy policy_;
+};
+
+#endif
@@ -26,12 +26,18 @@ public:
         return 10*c/total;
     }
 
+    // Encoded states of one player: 6 (lives) * 6 (bullets) * 6 (shields)
+    static constexpr int STATES_PER_PLAYER = 6*6*6;
+
+    // Scores of an action for analysis, indexed by QState::configToIndex.
+    // Learning updates them in place, the vectors never move.
+    const auto& scores(Action a) const { return state_.lookupAction(a); }
+
 private:
     explicit QLearner(const Rules& rules, int seed = 0) : Player(rules), rand_(seed) { }
 
     struct QState {
-        // Single player state can be encoded 216 values
-        // 6 (lives) * 6 (bullets) * 6 (shields) = 216 < 256
+        // Single player state can be encoded in STATES_PER_PLAYER = 216 values < 256
 
         // Whole game state takes 216*216 = 46656 entries
         // Multiply by 3 for each player choice (only 1 side)
@@ -48,10 +54,18 @@ private:
         std::vector<Score> qShield;
         std::vector<Score> qShoot;
 
-        std::vector<Score>* qLookup[3];
-
+        // No stored pointers to the vectors, they would not follow a copy of the QState
         std::vector<Score>& lookupAction(Action a) {
-            return *qLookup[(int)a];
+            switch(a) {
+                case Action::Reload: return qReload;
+                case Action::Shield: return qShield;
+                case Action::Shoot: return qShoot;
+            }
+            return qReload;
+        }
+
+        const std::vector<Score>& lookupAction(Action a) const {
+            return const_cast<QState*>(this)->lookupAction(a);
         }
 
         void update(int beforeIndex, int afterIndex, Action a, double prize) {
@@ -66,12 +80,9 @@ private:
         }
 
         QState() {
-            qReload.resize(216*216);
-            qShield.resize(216*216);
-            qShoot.resize(216*216);
-            qLookup[0] = &qReload;
-            qLookup[1] = &qShield;
-            qLookup[2] = &qShoot;
+            qReload.resize(STATES_PER_PLAYER*STATES_PER_PLAYER);
+            qShield.resize(STATES_PER_PLAYER*STATES_PER_PLAYER);
+            qShoot.resize(STATES_PER_PLAYER*STATES_PER_PLAYER);
         }
 
         static int configToIndex(const PlayerState& me, const PlayerState& opponent);
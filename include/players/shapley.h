@@ -3,23 +3,132 @@
 
 #include "player.h"
 #include "bilinearminmax.h"
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 
-struct GameGraph;
+struct ShapleyPolicy;
 
 class ShapleyPlayer : public Player {
 public:
+    enum class Iteration {
+        Jacobi,       // every state from the previous sweep's values, parallel
+        GaussSeidel,  // in place, successors first, single-threaded
+        Prioritized,  // in place, only states whose successors moved, single-threaded
+        Policy,       // Hoffman-Karp policy iteration per layer, in the order of Retrograde: fix the strategies
+                      // of A, solve the MDP left to B, repeat
+        Retrograde,   // in place, one (livesA, livesB) layer at a time from the fewest lives up, parallel
+    };
+
+    enum class Stopping {
+        Residual,         // sum over the states of |v - v+| at most tolerance
+        BellmanResidual,  // largest |v - v+| at most tolerance
+        PolicyStable,     // Residual, or no strategy moved for stableSweeps sweeps in a row
+    };
+
+    // Progress of the value iteration, reported after every sweep. Retrograde and Policy
+    // report once per total number of lives instead, after its layers are solved.
+    struct IterationReport {
+        int iteration = 0;
+        double l1Residual = 0.0;     // sum over the states of |v - v+|
+        double maxResidual = 0.0;    // largest |v - v+|
+        size_t strategyChanges = 0;  // states whose strategy moved by more than strategyTolerance
+        size_t solves = 0;           // stage games solved during the sweep
+        double seconds = 0.0;        // wall time of the sweep
+        SolveStats solverStats;      // solver counters since the start of the iteration
+    };
+
+    using IterationCallback = std::function<void(const IterationReport& report)>;
+
+    struct Params {
+        Iteration iteration = Iteration::Jacobi;
+        // Threads used by the Jacobi, Policy and Retrograde iterations, 0 uses every hardware thread
+        int threads = 0;
+        // Prioritized iteration: accumulated change of successors needed to solve a state again
+        double priorityThreshold = 1e-6;
+        Stopping stopping = Stopping::Residual;
+        double tolerance = 1e-3;
+        // Sweeps at most; at least one is always made
+        int maxIterations = 300;
+        // Largest probability move of a strategy still counted as no change
+        double strategyTolerance = 1e-6;
+        // PolicyStable: sweeps without strategy change needed to stop
+        int stableSweeps = 3;
+        // Called after every sweep, on the constructing thread
+        IterationCallback onIteration;
+        // Directory caching the solved policies by Rules and solver parameters, empty disables the cache.
+        // Cached policies are mapped read-only, so processes share them. defaultParams()
+        // takes it from the JAMESBOND_SHAPLEY_CACHE environment variable.
+        std::string cacheDirectory;
+        // Memory-lean solve for large rules: no stored edges and float values, about
+        // 12 bytes per reachable state while iterating instead of about 150.
+        // Only Jacobi runs in parallel, the other modes become in-place sweeps.
+        bool lean = false;
+        // Solved player, typically for neighbouring Rules, whose values seed the iteration.
+        // Only read during construction. A cached policy is still used, but a warm-started
+        // one is never written to the cache: its values depend on where the iteration started.
+        const ShapleyPlayer* warmStart = nullptr;
+        // Polled after every sweep, possibly from worker threads. Returning true stops the
+        // iteration with the values of the last completed sweep, the first one always completes;
+        // a policy stopped this way is not cached.
+        std::function<bool()> interrupt;
+    };
+
+    // Largest startLives, maxBullets and maxShields accepted by tryCreate
+    static constexpr int MAX_DIMENSION = 10;
+    static constexpr int LEAN_MAX_DIMENSION = 40;
+
+    // Params{} with the cache directory taken from the JAMESBOND_SHAPLEY_CACHE environment variable
+    static Params defaultParams();
+
     static std::unique_ptr<ShapleyPlayer> tryCreate(const Rules& rules, int seed = 0);
+    static std::unique_ptr<ShapleyPlayer> tryCreate(const Rules& rules, int seed, const Params& params);
     ~ShapleyPlayer();
     Action nextAction(const PlayerState& myState, const PlayerState& opponentState);
     void learnFromGame(const GameRecording& recording);
 
+    using StageGameCallback = std::function<void(size_t state, const std::array<std::array<double, 3>, 3>& A)>;
+
+    // Runs the value iteration without building a player and reports every stage game it solves.
+    static bool forEachStageGame(const Rules& rules, const StageGameCallback& callback);
+
+    // Wall time of the two phases of a (non-lean) solve, for benchmarks
+    struct SolveProfile {
+        size_t states = 0;
+        double graphSeconds = 0.0;      // discovery of the reachable states and their edges
+        double iterationSeconds = 0.0;  // value iteration
+        int iterations = 0;
+        size_t solves = 0;              // stage games solved by the iteration
+    };
+
+    // Runs both phases without building a player; params.onIteration is not called.
+    static bool profileSolve(const Rules& rules, const Params& params, SolveProfile* profile);
+
+    // Read-only view of the solved policy, owned by the player (possibly a mapped cache file).
+    // Node i is the i-th set bit of stateBitmap, whose bit k stands for the packed key
+    // k = indexA*statesPerPlayer + indexB with index = ((lives-1)*(maxBullets+1) + bullets)*(maxShields+1) + shields
+    // and statesPerPlayer = maxLives*(maxBullets+1)*(maxShields+1).
+    struct Tables {
+        size_t nodes = 0;
+        bool singlePrecision = false;            // float entries (lean solve) instead of double
+        const void* values = nullptr;            // mean payoff of A per node
+        const void* thresholds = nullptr;        // 3 per node: cumulative probabilities of reload, shield, shoot
+        const uint64_t* stateBitmap = nullptr;
+        size_t stateBitmapWords = 0;
+        int maxLives = 0;
+        int maxBullets = 0;
+        int maxShields = 0;
+    };
+
+    Tables tables() const;
+
 private:
-    std::unique_ptr<GameGraph> gameGraph_;
-    std::vector<StrategyPoint> meanPayoff_;
+    std::unique_ptr<ShapleyPolicy> policy_;
     Rand rand_;
 
-    explicit ShapleyPlayer(const Rules& rules, int seed = 0);
+    explicit ShapleyPlayer(const Rules& rules, int seed, const Params& params);
 };
 
 #endif
\ No newline at end of file
@@ -23,7 +23,12 @@ public:
 
     int pickWithBias(double p0, double p1, double p2) {
         std::array<double, 3> cumulative {{ p0, p0+p1, p0+p1+p2 }};
-        double total = p0+p1+p2;
+        return pickWithCumulativeBias(cumulative);
+    }
+
+    // Same draw as pickWithBias, with the running sums of the biases computed beforehand
+    int pickWithCumulativeBias(const std::array<double, 3>& cumulative) {
+        double total = cumulative[2];
         int r = pick(std::numeric_limits<int>::max());
         double p = total * (double)r / std::numeric_limits<int>::max();
         for(int i = 0; i < 3; ++i) {
@@ -0,0 +1,45 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running one parallel loop at a time.
+// The calling thread takes part in the loop as worker 0.
+class ThreadPool {
+public:
+    // nbThreads <= 0 uses every hardware thread
+    explicit ThreadPool(int nbThreads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)workers_.size() + 1; }
+
+    // Calls f(task, worker) for every task in [0, nbTasks) and returns once all are done.
+    // Tasks are handed out dynamically, worker is in [0, size()) and identifies
+    // the thread, so that per-worker scratch can be indexed with it.
+    void parallelFor(size_t nbTasks, const std::function<void(size_t task, int worker)>& f);
+
+private:
+    void work(int worker);
+    void runTasks(int worker);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    std::condition_variable done_;
+    const std::function<void(size_t, int)>* job_ = nullptr;
+    size_t nbTasks_ = 0;
+    std::atomic<size_t> nextTask_ { 0 };
+    size_t generation_ = 0;
+    int busyWorkers_ = 0;
+    bool stopping_ = false;
+};
+
+#endif
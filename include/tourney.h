@@ -1,13 +1,9 @@
 #ifndef TOURNEY_H
 #define TOURNEY_H
 
-#include "gamearena.h"
-#include "gamerecording.h"
 #include "player.h"
-#include "fmt/core.h"
-#include <algorithm>
+#include <cstdio>
 #include <vector>
-#include <memory>
 #include <string>
 
 class Tourney {
@@ -23,75 +19,37 @@ public:
         bool allowLearningB = true;
     };
 
-    void addPlayer(const std::string& name, Player* player) {
-        if(!player) return;
-        playerNames_.push_back(name);
-        players_.push_back(player);
-    }
+    // Same as play2v2 with up to batch games running side by side: every turn, a and b each get
+    // one nextActions call for all the running games. A finished game is learned from at once
+    // and replaced by the next one.
+    static Result play2v2Lockstep(int rounds, int batch, Player* a, Player* b, const Params& params, int* turns);
+
+    void addPlayer(const std::string& name, Player* player);
 
     static Result play2v2(int rounds, Player* a, Player* b, const Params& params) {
-        return playMatch(rounds, a, b, params);
+        return playMatch(rounds, a, b, params, nullptr);
+    }
+
+    // Same, writing the number of turns of every round to turns[0..rounds)
+    static Result play2v2(int rounds, Player* a, Player* b, const Params& params, int* turns) {
+        return playMatch(rounds, a, b, params, turns);
     }
 
     void run(int roundsPerMatch = 1000) {
-        Params noLearning { false, false };
-        std::vector<double> playerScores(players_.size(), 0);
-        size_t longestPlayerName = 0;
-        for(const auto& name : playerNames_) longestPlayerName = std::max(longestPlayerName, name.size());
-        for(size_t i = 0; i < players_.size(); ++i) {
-            fmt::print("{:{}}  ", playerNames_[i], (int)longestPlayerName);
-            for(size_t j = 0; j < players_.size(); ++j) {
-                if(i == j) {
-                    fmt::print("      ");
-                    continue;
-                }
-                auto result = playMatch(roundsPerMatch, players_[i], players_[j], noLearning);
-                playerScores[i] += result.winsA;
-                playerScores[j] += result.winsB;
-                fmt::print("{:.2f}  ", 1.0*result.winsA/roundsPerMatch);
-                if(result.winsA > result.winsB) {
-                    playerScores[i] += 500;
-                } else if (result.winsB > result.winsA) {
-                    playerScores[j] += 500;
-                } else {
-                    playerScores[i] += 100;
-                    playerScores[j] += 100;
-                }
-            }
-            fmt::print("\n");
-        }
-        fmt::print("\n");
-        std::vector<std::pair<double, std::string>> scoredPlayers;
-        scoredPlayers.reserve(players_.size());
-        for(size_t i = 0; i < players_.size(); ++i) {
-            scoredPlayers.emplace_back(playerScores[i],playerNames_[i]);
-        }
-        std::sort(scoredPlayers.begin(), scoredPlayers.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
-        fmt::print("Ranked by score:\n");
-        for(const auto& sp : scoredPlayers) {
-            fmt::print("{:{}} : {:8}\n", sp.second, longestPlayerName, sp.first);
-        }
+        run(roundsPerMatch, stdout);
     }
 
+    // Same, printing the table and the ranking to out, nothing when null
+    void run(int roundsPerMatch, std::FILE* out);
+
 private:
-    static Result playMatch(int rounds, Player* a, Player* b, const Params& params) {
-        Result result;
-        GameRecording recording(a, b);
-        bool withRecording = params.allowLearningA || params.allowLearningB;
-        for(int round = 0; round < rounds; ++round) {
-            GameArena arena;
-            const Player* winner = arena.play(a, b, withRecording ? &recording : nullptr);
-            if(params.allowLearningA) a->learnFromGame(recording);
-            if(params.allowLearningB) b->learnFromGame(recording);
-            if(!winner) ++result.ties;
-            if(winner == a) ++result.winsA;
-            if(winner == b) ++result.winsB;
-        }
-        return result;
-    }
+    static Result playMatch(int rounds, Player* a, Player* b, const Params& params, int* turns);
+
+    // Learning and tally of a finished round
+    static void endRound(const GameRecording& recording, const Player* winner, Player* a, Player* b, const Params& params, Result* result);
 
     std::vector<std::string> playerNames_;
     std::vector<Player*> players_;
 };
 
-#endif
\ No newline at end of file
+#endif
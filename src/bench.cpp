@@ -0,0 +1,319 @@
+#include "bilinearminmax.h"
+#include "gamearena.h"
+#include "gamerecording.h"
+#include "gamestate.h"
+#include "tourney.h"
+#include "players/biasedrandom.h"
+#include "players/bilinear.h"
+#include "players/qlearner.h"
+#include "players/random.h"
+#include "players/shapley.h"
+#include "rand.h"
+#include "fmt/core.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks of the engine hot paths.
+//
+//   jamesbond-bench [--size N] [--seed S] [--warmup W] [--repetitions R]
+//                   [--rules LIVES BULLETS SHIELDS] [--benchmarks NAME,NAME,...] [--json FILE]
+//
+// Every benchmark times a fixed batch of operations generated from the seed, so two runs with the
+// same arguments time the same work. A repetition is one pass over the batch; the statistics are
+// over the repetitions, in nanoseconds per operation. The Shapley benchmarks solve on one thread
+// and are timed phase by phase with ShapleyPlayer::profileSolve.
+
+struct Options {
+    size_t size = 100000;
+    int seed = 0;
+    int warmup = 2;
+    int repetitions = 10;
+    Rules rules;
+    std::string jsonFile;
+    std::vector<std::string> benchmarks;
+};
+
+struct TimingStats {
+    double min = 0.0;
+    double median = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string unit;   // what one operation is
+    size_t operations = 0;
+    TimingStats nsPerOperation;
+};
+
+static TimingStats computeStats(std::vector<double> samples) {
+    TimingStats stats;
+    if(samples.empty()) return stats;
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples.front();
+    size_t n = samples.size();
+    stats.median = n % 2 ? samples[n/2] : 0.5*(samples[n/2-1] + samples[n/2]);
+    for(double s : samples) stats.mean += s;
+    stats.mean /= n;
+    for(double s : samples) stats.stddev += (s - stats.mean)*(s - stats.mean);
+    stats.stddev = std::sqrt(stats.stddev / n);
+    return stats;
+}
+
+static bool isSelected(const Options& options, const std::string& name) {
+    return options.benchmarks.empty() || std::find(options.benchmarks.begin(), options.benchmarks.end(), name) != options.benchmarks.end();
+}
+
+// pass() runs the whole batch of operations and returns a checksum, kept so that the work is not optimized away
+template<typename Pass>
+static void run(const Options& options, const std::string& name, const std::string& unit, size_t operations, Pass&& pass, std::vector<BenchResult>* results) {
+    if(!isSelected(options, name) || operations == 0) return;
+    volatile double sink = 0;
+    for(int w = 0; w < options.warmup; ++w) sink = sink + pass();
+    std::vector<double> samples;
+    for(int r = 0; r < options.repetitions; ++r) {
+        auto begin = std::chrono::steady_clock::now();
+        sink = sink + pass();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - begin).count() / operations);
+    }
+    results->push_back(BenchResult { name, unit, operations, computeStats(std::move(samples)) });
+}
+
+// States met in actual play, with legal actions for both players: random games from the start,
+// recorded turn by turn
+struct Turn {
+    GameState state;
+    Action actionA;
+    Action actionB;
+};
+
+static std::vector<Turn> playedTurns(const Rules& rules, size_t size, int seed) {
+    Rand rand(seed);
+    std::vector<Turn> turns;
+    turns.reserve(size);
+    while(turns.size() < size) {
+        GameState s;
+        for(int t = 0; t < rules.maxTurns && !s.gameOver() && turns.size() < size; ++t) {
+            Action a = s.stateA().randomAllowedAction(&rand, rules);
+            Action b = s.stateB().randomAllowedAction(&rand, rules);
+            turns.push_back(Turn { s, a, b });
+            s.resolve(a, b, rules);
+        }
+    }
+    return turns;
+}
+
+static double actionChecksum(Action a) {
+    return (double)(int)a;
+}
+
+static void benchmarkGameState(const Options& options, std::vector<BenchResult>* results) {
+    std::vector<Turn> turns = playedTurns(options.rules, options.size, options.seed);
+    run(options, "gamestate-resolve", "resolve", turns.size(), [&]() {
+        double sum = 0;
+        for(const Turn& turn : turns) {
+            GameState s = turn.state;
+            s.resolve(turn.actionA, turn.actionB, options.rules);
+            sum += s.stateA().lives() + s.stateB().bullets();
+        }
+        return sum;
+    }, results);
+}
+
+static void benchmarkRand(const Options& options, std::vector<BenchResult>* results) {
+    Rand rand(options.seed);
+    run(options, "rand-pick", "pick(3)", options.size, [&]() {
+        double sum = 0;
+        for(size_t i = 0; i < options.size; ++i) sum += rand.pick(3);
+        return sum;
+    }, results);
+    run(options, "rand-pick-with-bias", "pickWithBias", options.size, [&]() {
+        double sum = 0;
+        for(size_t i = 0; i < options.size; ++i) sum += rand.pickWithBias(0.2, 0.3, 0.5);
+        return sum;
+    }, results);
+}
+
+static void benchmarkNextAction(const Options& options, const std::string& name, Player* player, const std::vector<Turn>& turns, std::vector<BenchResult>* results) {
+    if(!player) return;
+    run(options, "next-action-" + name, "nextAction", turns.size(), [&]() {
+        double sum = 0;
+        for(const Turn& turn : turns) sum += actionChecksum(player->nextAction(turn.state.stateA(), turn.state.stateB()));
+        return sum;
+    }, results);
+}
+
+static void benchmarkPlayers(const Options& options, std::vector<BenchResult>* results) {
+    const Rules& rules = options.rules;
+    std::vector<Turn> turns = playedTurns(rules, options.size, options.seed + 1);
+
+    RandomPlayer random(rules, options.seed);
+    BiasedRandomPlayer biasedRandom(rules, options.seed, 1, 2, 3);
+    BilinearPlayer bilinear(rules, options.seed);
+    benchmarkNextAction(options, "random", &random, turns, results);
+    benchmarkNextAction(options, "biased-random", &biasedRandom, turns, results);
+    benchmarkNextAction(options, "bilinear", &bilinear, turns, results);
+
+    bool wantsQLearner = isSelected(options, "next-action-qlearner") || isSelected(options, "qlearner-learn") || isSelected(options, "recording-replay");
+    std::unique_ptr<QLearner> qlearner = wantsQLearner ? QLearner::tryCreate(rules, options.seed) : nullptr;
+    if(qlearner) {
+        // Trained the way jb_createPlayer does, on fewer games
+        RandomPlayer opponent(rules, options.seed + 1);
+        Tourney::play2v2(10000, &opponent, qlearner.get(), Tourney::Params { false, true });
+        benchmarkNextAction(options, "qlearner", qlearner.get(), turns, results);
+    }
+
+    if(isSelected(options, "next-action-shapley")) {
+        ShapleyPlayer::Params params;
+        params.threads = 1;
+        auto shapley = ShapleyPlayer::tryCreate(rules, options.seed, params);
+        benchmarkNextAction(options, "shapley", shapley.get(), turns, results);
+    }
+
+    // Whole games between random players, recorded once and then learned from or replayed
+    if(qlearner) {
+        RandomPlayer a(rules, options.seed + 2);
+        RandomPlayer b(rules, options.seed + 3);
+        const size_t nbGames = std::max<size_t>(1, options.size / 100);
+        std::vector<GameRecording> recordings(nbGames, GameRecording(&a, &b));
+        size_t nbTurns = 0;
+        for(auto& recording : recordings) {
+            GameArena arena;
+            arena.play(&a, &b, &recording);
+            nbTurns += arena.turns();
+        }
+        // The recordings name a and b; the learner takes the side of b
+        run(options, "qlearner-learn", "game", recordings.size(), [&]() {
+            for(const auto& recording : recordings) qlearner->learnFromGame(recording);
+            return qlearner->scores(Action::Reload)[0].score;
+        }, results);
+        run(options, "recording-replay", "turn", nbTurns, [&]() {
+            double sum = 0;
+            for(const auto& recording : recordings) {
+                recording.replay([&](const GameStateSnapshot&, const GameStateSnapshot& after, Action, Action) {
+                    sum += after.stateA.lives();
+                });
+            }
+            return sum;
+        }, results);
+    }
+}
+
+static void benchmarkBilinearSolve(const Options& options, std::vector<BenchResult>* results) {
+    Rand rand(options.seed);
+    std::vector<std::array<std::array<double, 3>, 3>> matrices(std::max<size_t>(1, options.size / 10));
+    for(auto& A : matrices) {
+        for(auto& row : A) for(auto& e : row) e = rand.pick(2001) - 1000;
+    }
+    run(options, "bilinear-solve", "solve", matrices.size(), [&]() {
+        double sum = 0;
+        for(const auto& A : matrices) sum += BilinearMinMax::solve(A).value;
+        return sum;
+    }, results);
+}
+
+static void benchmarkShapley(const Options& options, std::vector<BenchResult>* results) {
+    bool graph = isSelected(options, "shapley-make-graph");
+    bool iteration = isSelected(options, "shapley-mean-payoff");
+    if(!graph && !iteration) return;
+    ShapleyPlayer::Params params;
+    params.threads = 1;
+    ShapleyPlayer::SolveProfile profile;
+    std::vector<double> graphSamples;
+    std::vector<double> iterationSamples;
+    for(int r = 0; r < options.warmup + options.repetitions; ++r) {
+        if(!ShapleyPlayer::profileSolve(options.rules, params, &profile)) return;
+        if(r < options.warmup) continue;
+        graphSamples.push_back(1e9 * profile.graphSeconds / std::max<size_t>(1, profile.states));
+        iterationSamples.push_back(1e9 * profile.iterationSeconds / std::max<size_t>(1, profile.solves));
+    }
+    if(graph) results->push_back(BenchResult { "shapley-make-graph", "state", profile.states, computeStats(std::move(graphSamples)) });
+    if(iteration) results->push_back(BenchResult { "shapley-mean-payoff", "stage game", profile.solves, computeStats(std::move(iterationSamples)) });
+}
+
+// JSON has no representation for infinities or NaNs
+static std::string jsonNumber(double x) {
+    return std::isfinite(x) ? fmt::format("{}", x) : std::string("null");
+}
+
+static void writeJson(const Options& options, const std::vector<BenchResult>& results) {
+    std::FILE* file = std::fopen(options.jsonFile.c_str(), "w");
+    if(!file) {
+        fmt::print(stderr, "Unable to open {}\n", options.jsonFile);
+        return;
+    }
+    fmt::print(file, "{{\n  \"seed\": {},\n  \"warmup\": {},\n  \"repetitions\": {},\n  \"rules\": [{}, {}, {}],\n  \"results\": [\n",
+               options.seed, options.warmup, options.repetitions, options.rules.startLives, options.rules.maxBullets, options.rules.maxShields);
+    for(size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        fmt::print(file, "    {{\"name\": \"{}\", \"unit\": \"{}\", \"operations\": {}, "
+                         "\"ns_per_operation\": {{\"min\": {}, \"median\": {}, \"mean\": {}, \"stddev\": {}}}}}{}\n",
+                   r.name, r.unit, r.operations,
+                   jsonNumber(r.nsPerOperation.min), jsonNumber(r.nsPerOperation.median), jsonNumber(r.nsPerOperation.mean), jsonNumber(r.nsPerOperation.stddev),
+                   i+1 < results.size() ? "," : "");
+    }
+    fmt::print(file, "  ]\n}}\n");
+    std::fclose(file);
+}
+
+static bool parseOptions(int argc, char** argv, Options* options) {
+    for(int i = 1; i < argc; ++i) {
+        auto is = [&](const char* flag, int nbValues) { return !std::strcmp(argv[i], flag) && i + nbValues < argc; };
+        if(is("--size", 1)) {
+            options->size = std::atol(argv[++i]);
+        } else if(is("--seed", 1)) {
+            options->seed = std::atoi(argv[++i]);
+        } else if(is("--warmup", 1)) {
+            options->warmup = std::atoi(argv[++i]);
+        } else if(is("--repetitions", 1)) {
+            options->repetitions = std::atoi(argv[++i]);
+        } else if(is("--rules", 3)) {
+            options->rules.startLives = std::atoi(argv[++i]);
+            options->rules.maxBullets = std::atoi(argv[++i]);
+            options->rules.maxShields = std::atoi(argv[++i]);
+        } else if(is("--json", 1)) {
+            options->jsonFile = argv[++i];
+        } else if(is("--benchmarks", 1)) {
+            std::string list = argv[++i];
+            size_t begin = 0;
+            while(begin <= list.size()) {
+                size_t end = std::min(list.find(',', begin), list.size());
+                options->benchmarks.push_back(list.substr(begin, end - begin));
+                begin = end + 1;
+            }
+        } else {
+            fmt::print(stderr, "Unknown or incomplete option {}\n", argv[i]);
+            return false;
+        }
+    }
+    return options->repetitions > 0 && options->warmup >= 0 && options->size > 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if(!parseOptions(argc, argv, &options)) return 2;
+
+    std::vector<BenchResult> results;
+    benchmarkGameState(options, &results);
+    benchmarkRand(options, &results);
+    benchmarkPlayers(options, &results);
+    benchmarkBilinearSolve(options, &results);
+    benchmarkShapley(options, &results);
+
+    fmt::print("{:26} {:>12} {:>10} {:>10} {:>10} {:>8}\n", "benchmark", "unit", "ops", "min ns", "median ns", "stddev");
+    for(const auto& r : results) {
+        fmt::print("{:26} {:>12} {:10} {:10.1f} {:10.1f} {:8.1f}\n",
+                   r.name, r.unit, r.operations, r.nsPerOperation.min, r.nsPerOperation.median, r.nsPerOperation.stddev);
+    }
+    if(!options.jsonFile.empty()) writeJson(options, results);
+    return 0;
+}
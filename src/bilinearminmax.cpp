@@ -1,8 +1,10 @@
 #include "bilinearminmax.h"
+#include "counters.h"
 #include "fmt/core.h"
 #include "glpk.h"
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <limits>
 #include <vector>
 
@@ -32,6 +34,23 @@ struct SimplexSolver {
         parm.meth = GLP_DUAL;
         parm.presolve = GLP_OFF;
         parm.r_test = GLP_RT_STD;
+
+        // The sparsity pattern never changes, only the 9 payoff entries do
+        ia[1] = 1, ja[1] = 1;
+        ia[2] = 1, ja[2] = 2;
+        ia[3] = 1, ja[3] = 3;
+        ia[4] = 1, ja[4] = 4, ar[4] = -1.0;
+        ia[5] = 2, ja[5] = 1;
+        ia[6] = 2, ja[6] = 2;
+        ia[7] = 2, ja[7] = 3;
+        ia[8] = 2, ja[8] = 4, ar[8] = -1.0;
+        ia[9] = 3, ja[9] = 1;
+        ia[10] = 3, ja[10] = 2;
+        ia[11] = 3, ja[11] = 3;
+        ia[12] = 3, ja[12] = 4, ar[12] = -1.0;
+        ia[13] = 4, ja[13] = 1, ar[13] = 1.0;
+        ia[14] = 4, ja[14] = 2, ar[14] = 1.0;
+        ia[15] = 4, ja[15] = 3, ar[15] = 1.0;
     }
 
     ~SimplexSolver() {
@@ -40,9 +59,19 @@ struct SimplexSolver {
 
     glp_prob* lp;
     glp_smcp parm;
+    int ia[1+15];
+    int ja[1+15];
+    double ar[1+15];
 };
 
-static SimplexSolver ss;
+SolverContext::SolverContext() : simplex_(std::make_unique<SimplexSolver>()) { }
+
+SolverContext::~SolverContext() = default;
+
+SolverContext& SolverContext::forThisThread() {
+    thread_local SolverContext context;
+    return context;
+}
 
 
 [[maybe_unused]] static inline void printCostMatrix(const std::array<std::array<double, 3>, 3>& A) {
@@ -51,12 +80,16 @@ static SimplexSolver ss;
     fmt::print("{:6} {:6} {:6}\n", A[2][0], A[2][1], A[2][2]);
 }
 
+static bool isDistribution(const Point& p) {
+    for(int i = 0; i < 3; ++i) {
+        if(p.p[i] != p.p[i] || p.p[i] <= -0.0000001 || p.p[i] >= 1.0000001) return false;
+    }
+    double sum = p.p[0] + p.p[1] + p.p[2];
+    return sum < 1.0000001 && sum > 1-0.0000001;
+}
+
 static double evalCandidate(const std::array<std::array<double, 3>, 3>& A, const Point& p) {
-    if(p.p[0] != p.p[0] || p.p[0] <= -0.0000001 || p.p[0] >= 1.0000001) return std::numeric_limits<double>::infinity();
-    if(p.p[1] != p.p[1] || p.p[1] <= -0.0000001 || p.p[1] >= 1.0000001) return std::numeric_limits<double>::infinity();
-    if(p.p[2] != p.p[2] || p.p[2] <= -0.0000001 || p.p[2] >= 1.0000001) return std::numeric_limits<double>::infinity();
-    if(p.p[0] + p.p[1] + p.p[2] >= 1.0000001) return std::numeric_limits<double>::infinity();
-    if(p.p[0] + p.p[1] + p.p[2] <= 1-0.0000001) return std::numeric_limits<double>::infinity();
+    if(!isDistribution(p)) return std::numeric_limits<double>::infinity();
     double value = -std::numeric_limits<double>::infinity();
     for(int j = 0; j < 3; ++j) {
         double v = 0;
@@ -68,25 +101,18 @@ static double evalCandidate(const std::array<std::array<double, 3>, 3>& A, const
     return value;
 };
 
-StrategyPoint BilinearMinMax::solveBetter(const std::array<std::array<double, 3>, 3>& A) {
-    int ia[1+15], ja[1+15];
-    double ar[1+15];
-    ia[1] = 1, ja[1] = 1, ar[1] = A[0][0];
-    ia[2] = 1, ja[2] = 2, ar[2] = A[1][0];
-    ia[3] = 1, ja[3] = 3, ar[3] = A[2][0];
-    ia[4] = 1, ja[4] = 4, ar[4] = -1.0;
-    ia[5] = 2, ja[5] = 1, ar[5] = A[0][1];
-    ia[6] = 2, ja[6] = 2, ar[6] = A[1][1];
-    ia[7] = 2, ja[7] = 3, ar[7] = A[2][1];
-    ia[8] = 2, ja[8] = 4, ar[8] = -1.0;
-    ia[9] = 3, ja[9] = 1, ar[9] = A[0][2];
-    ia[10] = 3, ja[10] = 2, ar[10] = A[1][2];
-    ia[11] = 3, ja[11] = 3, ar[11] = A[2][2];
-    ia[12] = 3, ja[12] = 4, ar[12] = -1.0;
-    ia[13] = 4, ja[13] = 1, ar[13] = 1.0;
-    ia[14] = 4, ja[14] = 2, ar[14] = 1.0;
-    ia[15] = 4, ja[15] = 3, ar[15] = 1.0;
-    glp_load_matrix(ss.lp, 15, ia, ja, ar);
+StrategyPoint BilinearMinMax::solveBetter(const std::array<std::array<double, 3>, 3>& A, SolverContext& context) {
+    SimplexSolver& ss = *context.simplex_;
+    ss.ar[1] = A[0][0];
+    ss.ar[2] = A[1][0];
+    ss.ar[3] = A[2][0];
+    ss.ar[5] = A[0][1];
+    ss.ar[6] = A[1][1];
+    ss.ar[7] = A[2][1];
+    ss.ar[9] = A[0][2];
+    ss.ar[10] = A[1][2];
+    ss.ar[11] = A[2][2];
+    glp_load_matrix(ss.lp, 15, ss.ia, ss.ja, ss.ar);
     glp_term_out(GLP_OFF);
     glp_std_basis(ss.lp);
     glp_simplex(ss.lp, &ss.parm);
@@ -143,21 +169,28 @@ std::array<double, 3> solve3x3(const std::array<std::array<double, 3>, 3>& A, co
     }
 }
 
-StrategyPoint BilinearMinMax::solveFast(const std::array<std::array<double, 3>, 3>& A) {
-    std::vector<Point> candidates;
+static constexpr int NB_SUPPORTS = 10;
+static constexpr int FULL_SUPPORT = 9;
 
-    candidates.push_back(Point{ (A[1][1]-A[1][0])/(A[1][1]-A[1][0]+A[0][0]-A[0][1]), (A[0][0]-A[0][1])/(A[1][1]-A[1][0]+A[0][0]-A[0][1]), 0 });
-    candidates.push_back(Point{ (A[1][2]-A[1][0])/(A[1][2]-A[1][0]+A[0][0]-A[0][2]), (A[0][0]-A[0][2])/(A[1][2]-A[1][0]+A[0][0]-A[0][2]), 0 });
-    candidates.push_back(Point{ (A[1][1]-A[1][2])/(A[1][1]-A[1][2]+A[0][2]-A[0][1]), (A[0][2]-A[0][1])/(A[1][1]-A[1][2]+A[0][2]-A[0][1]), 0 });
+// Supports 0..8 are (pair of rows, pair of columns) with pairs ordered {0,1}, {0,2}, {1,2},
+// support 9 mixes over all rows and all columns.
+static constexpr std::array<std::array<int, 2>, 3> SUPPORT_PAIRS {{ {{0, 1}}, {{0, 2}}, {{1, 2}} }};
 
-    candidates.push_back(Point{ (A[2][1]-A[2][0])/(A[2][1]-A[2][0]+A[0][0]-A[0][1]), 0, (A[0][0]-A[0][1])/(A[2][1]-A[2][0]+A[0][0]-A[0][1]) });
-    candidates.push_back(Point{ (A[2][2]-A[2][0])/(A[2][2]-A[2][0]+A[0][0]-A[0][2]), 0, (A[0][0]-A[0][2])/(A[2][2]-A[2][0]+A[0][0]-A[0][2]) });
-    candidates.push_back(Point{ (A[2][1]-A[2][2])/(A[2][1]-A[2][2]+A[0][2]-A[0][1]), 0, (A[0][2]-A[0][1])/(A[2][1]-A[2][2]+A[0][2]-A[0][1]) });
+static Point rowCandidate(const std::array<std::array<double, 3>, 3>& A, int support) {
+    switch(support) {
+        case 0: return Point{ (A[1][1]-A[1][0])/(A[1][1]-A[1][0]+A[0][0]-A[0][1]), (A[0][0]-A[0][1])/(A[1][1]-A[1][0]+A[0][0]-A[0][1]), 0 };
+        case 1: return Point{ (A[1][2]-A[1][0])/(A[1][2]-A[1][0]+A[0][0]-A[0][2]), (A[0][0]-A[0][2])/(A[1][2]-A[1][0]+A[0][0]-A[0][2]), 0 };
+        case 2: return Point{ (A[1][1]-A[1][2])/(A[1][1]-A[1][2]+A[0][2]-A[0][1]), (A[0][2]-A[0][1])/(A[1][1]-A[1][2]+A[0][2]-A[0][1]), 0 };
 
-    candidates.push_back(Point{ 0, (A[2][0]-A[2][1])/(A[1][1]-A[1][0]+A[2][0]-A[2][1]), (A[1][1]-A[1][0])/(A[1][1]-A[1][0]+A[2][0]-A[2][1]) });
-    candidates.push_back(Point{ 0, (A[2][0]-A[2][2])/(A[1][2]-A[1][0]+A[2][0]-A[2][2]), (A[1][2]-A[1][0])/(A[1][2]-A[1][0]+A[2][0]-A[2][2]) });
-    candidates.push_back(Point{ 0, (A[2][2]-A[2][1])/(A[1][1]-A[1][2]+A[2][2]-A[2][1]), (A[1][1]-A[1][2])/(A[1][1]-A[1][2]+A[2][2]-A[2][1]) });
+        case 3: return Point{ (A[2][1]-A[2][0])/(A[2][1]-A[2][0]+A[0][0]-A[0][1]), 0, (A[0][0]-A[0][1])/(A[2][1]-A[2][0]+A[0][0]-A[0][1]) };
+        case 4: return Point{ (A[2][2]-A[2][0])/(A[2][2]-A[2][0]+A[0][0]-A[0][2]), 0, (A[0][0]-A[0][2])/(A[2][2]-A[2][0]+A[0][0]-A[0][2]) };
+        case 5: return Point{ (A[2][1]-A[2][2])/(A[2][1]-A[2][2]+A[0][2]-A[0][1]), 0, (A[0][2]-A[0][1])/(A[2][1]-A[2][2]+A[0][2]-A[0][1]) };
 
+        case 6: return Point{ 0, (A[2][0]-A[2][1])/(A[1][1]-A[1][0]+A[2][0]-A[2][1]), (A[1][1]-A[1][0])/(A[1][1]-A[1][0]+A[2][0]-A[2][1]) };
+        case 7: return Point{ 0, (A[2][0]-A[2][2])/(A[1][2]-A[1][0]+A[2][0]-A[2][2]), (A[1][2]-A[1][0])/(A[1][2]-A[1][0]+A[2][0]-A[2][2]) };
+        case 8: return Point{ 0, (A[2][2]-A[2][1])/(A[1][1]-A[1][2]+A[2][2]-A[2][1]), (A[1][1]-A[1][2])/(A[1][1]-A[1][2]+A[2][2]-A[2][1]) };
+    }
+    assert(support == FULL_SUPPORT);
     std::array<std::array<double, 3>, 3> M {{
         { A[0][0] - A[0][1], A[1][0] - A[1][1], A[2][0] - A[2][1] },
         { A[0][1] - A[0][2], A[1][1] - A[1][2], A[2][1] - A[2][2] },
@@ -165,23 +198,82 @@ StrategyPoint BilinearMinMax::solveFast(const std::array<std::array<double, 3>,
     }};
     std::array<double, 3> b {{ 0, 0, 1 }};
     auto s = solve3x3(M, b);
-    candidates.push_back(Point{s[0], s[1], s[2]});
+    return Point{s[0], s[1], s[2]};
+}
+
+// Strategy of the maximizing (column) player that equalizes the rows of the support.
+static Point columnCandidate(const std::array<std::array<double, 3>, 3>& A, int support) {
+    if(support == FULL_SUPPORT) {
+        std::array<std::array<double, 3>, 3> M {{
+            { A[0][0] - A[1][0], A[0][1] - A[1][1], A[0][2] - A[1][2] },
+            { A[1][0] - A[2][0], A[1][1] - A[2][1], A[1][2] - A[2][2] },
+            { 1, 1, 1 }
+        }};
+        std::array<double, 3> b {{ 0, 0, 1 }};
+        auto s = solve3x3(M, b);
+        return Point{s[0], s[1], s[2]};
+    }
+    int i = SUPPORT_PAIRS[support/3][0];
+    int k = SUPPORT_PAIRS[support/3][1];
+    int j = SUPPORT_PAIRS[support%3][0];
+    int l = SUPPORT_PAIRS[support%3][1];
+    double d = A[k][l] - A[i][l] + A[i][j] - A[k][j];
+    Point q {0, 0, 0};
+    q.p[j] = (A[k][l] - A[i][l]) / d;
+    q.p[l] = (A[i][j] - A[k][j]) / d;
+    return q;
+}
+
+// Lowest payoff the row player can be held to when the column player plays q.
+static double evalColumnCandidate(const std::array<std::array<double, 3>, 3>& A, const Point& q) {
+    if(!isDistribution(q)) return -std::numeric_limits<double>::infinity();
+    double value = std::numeric_limits<double>::infinity();
+    for(int i = 0; i < 3; ++i) {
+        double v = 0;
+        for(int j = 0; j < 3; ++j) {
+            v += A[i][j] * q.p[j];
+        }
+        value = std::min(value, v);
+    }
+    return value;
+}
 
+StrategyPoint BilinearMinMax::solveFast(const std::array<std::array<double, 3>, 3>& A, int* support) {
     Point bestPoint {0, 0, 0};
     double bestValue = std::numeric_limits<double>::infinity();
+    int bestSupport = -1;
 
-    for(const auto& p : candidates) {
+    for(int s = 0; s < NB_SUPPORTS; ++s) {
+        Point p = rowCandidate(A, s);
         double value = evalCandidate(A, p);
         if(value < bestValue) {
             bestValue = value;
             bestPoint = p;
+            bestSupport = s;
         }
     }
+    if(support) *support = bestSupport;
    
     return StrategyPoint { bestValue, bestPoint };
 }
 
-StrategyPoint BilinearMinMax::solve(const std::array<std::array<double, 3>, 3>& A) {
+// Cheap optimality certificate: the row strategy of the support guarantees at most `upper`,
+// the column strategy of the same support guarantees at least `lower`. When both bounds meet,
+// the row strategy is optimal and the full enumeration can be skipped.
+bool BilinearMinMax::solveWithSupport(const std::array<std::array<double, 3>, 3>& A, int support, StrategyPoint* solution, Point* columnStrategy) {
+    if(support < 0 || support >= NB_SUPPORTS) return false;
+    Point p = rowCandidate(A, support);
+    double upper = evalCandidate(A, p);
+    if(std::isinf(upper)) return false;
+    Point q = columnCandidate(A, support);
+    double lower = evalColumnCandidate(A, q);
+    if(upper - lower > 1e-9 * std::max(1.0, std::abs(upper))) return false;
+    *solution = StrategyPoint { upper, p };
+    if(columnStrategy) *columnStrategy = q;
+    return true;
+}
+
+static bool solvePure(const std::array<std::array<double, 3>, 3>& A, StrategyPoint* solution, Point* columnStrategy = nullptr) {
     const double inf = std::numeric_limits<double>::infinity();
     std::array<double, 3> maxByRow {{ -inf, -inf, -inf }};
     std::array<double, 3> minByCol {{ +inf, +inf, +inf }};
@@ -193,13 +285,65 @@ StrategyPoint BilinearMinMax::solve(const std::array<std::array<double, 3>, 3>&
     }
     auto minValueIt = std::max_element(minByCol.begin(), minByCol.end());
     auto maxValueIt = std::min_element(maxByRow.begin(), maxByRow.end());
-    if(*maxValueIt != *minValueIt) {
-        auto f = solveFast(A);
-        return f;
-        // auto b = solveBetter(A);
-        // return b;
-    }
+    if(*maxValueIt != *minValueIt) return false;
     Point a {0, 0, 0};
     a.p[std::distance(maxByRow.begin(), maxValueIt)] = 1;
-    return StrategyPoint { *minValueIt, a };
-}
\ No newline at end of file
+    *solution = StrategyPoint { *minValueIt, a };
+    if(columnStrategy) {
+        Point b {0, 0, 0};
+        b.p[std::distance(minByCol.begin(), minValueIt)] = 1;
+        *columnStrategy = b;
+    }
+    return true;
+}
+
+StrategyPoint BilinearMinMax::solve(const std::array<std::array<double, 3>, 3>& A) {
+    StrategyPoint solution;
+    if(solvePure(A, &solution)) {
+        Counters::add(Counter::PureSolves);
+        return solution;
+    }
+    Counters::add(Counter::MixedSolves);
+    return solveFast(A);
+    // return solveExact(A, SolverContext::forThisThread());
+}
+
+bool BilinearMinMax::solveCertified(const std::array<std::array<double, 3>, 3>& A, StrategyPoint* solution, Point* columnStrategy) {
+    if(solvePure(A, solution, columnStrategy)) {
+        Counters::add(Counter::PureSolves);
+        return true;
+    }
+    Counters::add(Counter::MixedSolves);
+    for(int s = 0; s < NB_SUPPORTS; ++s) {
+        if(solveWithSupport(A, s, solution, columnStrategy)) return true;
+    }
+    return false;
+}
+
+StrategyPoint BilinearMinMax::solve(const std::array<std::array<double, 3>, 3>& A, SolverContext& context, SupportHint* hint) {
+    StrategyPoint solution;
+    if(solvePure(A, &solution)) {
+        ++context.stats.pureSolves;
+        Counters::add(Counter::PureSolves);
+        return solution;
+    }
+    Counters::add(Counter::MixedSolves);
+    if(!hint) return solveFast(A);
+    if(solveWithSupport(A, hint->support, &solution)) {
+        ++context.stats.hintHits;
+        return solution;
+    }
+    ++context.stats.hintMisses;
+    return solveFast(A, &hint->support);
+}
+
+StrategyPoint BilinearMinMax::solveExact(const std::array<std::array<double, 3>, 3>& A, SolverContext& context) {
+    StrategyPoint solution;
+    if(solvePure(A, &solution)) {
+        ++context.stats.pureSolves;
+        Counters::add(Counter::PureSolves);
+        return solution;
+    }
+    Counters::add(Counter::MixedSolves);
+    return solveBetter(A, context);
+}
@@ -1,262 +1,388 @@
+#include "bilinearminmax.h"
+#include "matrixgame.h"
+#include "players/shapley.h"
+#include "rand.h"
+#include "fmt/core.h"
+#include <algorithm>
 #include <array>
-#include <limits>
 #include <cassert>
-#include <cstddef>
-#include <algorithm>
-#include <fstream>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <utility>
 #include <vector>
-#include "fmt/core.h"
-#include "glpk.h"
 
-struct Point { double p[3]; };
+// Benchmark and cross-check of every 3x3 stage-game solver.
+//
+//   bench_bilinear_solve [--size N] [--seed S] [--warmup W] [--repetitions R]
+//                        [--rules LIVES BULLETS SHIELDS] [--matrices FILE] [--dump FILE]
+//                        [--paths NAME,NAME,...] [--json FILE]
+//
+// Corpora are generated from the seed, so two runs with the same arguments time the same matrices.
+// The "shapley" corpus samples the stage games solved while building a ShapleyPlayer, --dump writes
+// it in the historical "matrices" format (9 entries per line) and --matrices reads such a file back.
+// Every path is checked against the dense simplex; the exit code is non-zero on any mismatch.
+// Warm-start hints start cold on every pass over a corpus, the hit rate reported is the one of the last timed pass.
 
-struct StrategyPoint {
-    double value = 0.0;
-    Point a {};
-    Point b {};
+using Matrix = std::array<std::array<double, 3>, 3>;
+
+struct Corpus {
+    std::string name;
+    std::vector<Matrix> matrices;
+    std::vector<size_t> keys; // identifies the stage game a matrix comes from, used for warm-start hints
 };
 
-struct BilinearMinMax {
+struct Options {
+    size_t size = 10000;
+    int seed = 0;
+    int warmup = 2;
+    int repetitions = 10;
+    Rules rules;
+    std::string matricesFile;
+    std::string dumpFile;
+    std::string jsonFile;
+    std::vector<std::string> paths;
+};
 
-    static constexpr double RESOLUTION = 1.0/6.0;
+struct TimingStats {
+    double min = 0.0;
+    double median = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+};
 
-    static StrategyPoint solveBad(const std::array<std::array<double, 3>, 3>& A) {
-        Point x;
-        Point y;
-        double bestXValue = +std::numeric_limits<double>::infinity();
-        Point bestXPoint {0, 0, 0};
-        Point bestXYPoint {0, 0, 0};
-        for(x.p[0] = 0; x.p[0] <= 1; x.p[0] += RESOLUTION) {
-            for(x.p[1] = 0; x.p[1] <= 1 - x.p[0]; x.p[1] += RESOLUTION) {
-                x.p[2] = 1 - x.p[0] - x.p[1];
-                double bestYValue = -std::numeric_limits<double>::infinity();
-                Point bestYPoint {0, 0, 0};
-                auto eval = [&](const Point& y) {
-                    double val = 0.0;
-                    for(int i = 0; i < 3; ++i) {
-                        if(x.p[i] == 0) continue;
-                        for(int j = 0; j < 3; ++j) {
-                            if(y.p[j] == 0) continue;
-                            assert(A[i][j] == A[i][j]);
-                            val += A[i][j] * x.p[i] * y.p[j];
-                        }
-                    }
-                    assert(val == val);
-                    return val;
-                };
-                for(y.p[0] = 0; y.p[0] <= 1; y.p[0] += RESOLUTION) {
-                    for(y.p[1] = 0; y.p[1] <= 1 - y.p[0]; y.p[1] += RESOLUTION) {
-                        y.p[2] = 1 - y.p[0] - y.p[1];
-                        double val = eval(y);
-                        if(val > bestYValue) {
-                            bestYValue = val;
-                            bestYPoint = y;
-                        }
-                    }
-                }
-                if(bestYValue < bestXValue) {
-                    bestXValue = bestYValue;
-                    bestXPoint = x;
-                    bestXYPoint = bestYPoint;
-                }
-            }
+struct PathResult {
+    std::string corpus;
+    std::string path;
+    size_t size = 0;
+    TimingStats nsPerSolve;
+    size_t mismatches = 0;
+    double maxValueError = 0.0;
+    double maxStrategyGap = 0.0;
+    double hintHitRate = std::numeric_limits<double>::quiet_NaN(); // NaN for paths without hints
+};
+
+static double uniform(Rand& rand, double lo, double hi) {
+    const int resolution = 1 << 30;
+    return lo + (hi - lo) * rand.pick(resolution) / resolution;
+}
+
+static Corpus randomCorpus(size_t size, int seed) {
+    Rand rand(seed);
+    Corpus c { "random", {}, {} };
+    for(size_t k = 0; k < size; ++k) {
+        Matrix A;
+        for(auto& row : A) for(auto& e : row) e = uniform(rand, -100, 100);
+        c.matrices.push_back(A);
+        c.keys.push_back(k);
+    }
+    return c;
+}
+
+// Small integer entries with duplicated rows and columns: ties everywhere and many games
+// with several optimal strategies.
+static Corpus degenerateCorpus(size_t size, int seed) {
+    Rand rand(seed);
+    Corpus c { "degenerate", {}, {} };
+    for(size_t k = 0; k < size; ++k) {
+        Matrix A;
+        for(auto& row : A) for(auto& e : row) e = rand.pick(3) - 1;
+        int src = rand.pick(3);
+        int dst = rand.pick(3);
+        if(rand.pick(2) == 0) {
+            A[dst] = A[src];
+        } else {
+            for(int i = 0; i < 3; ++i) A[i][dst] = A[i][src];
         }
-        return StrategyPoint { bestXValue, bestXPoint, bestXYPoint };
+        c.matrices.push_back(A);
+        c.keys.push_back(k);
     }
+    return c;
+}
 
-    static StrategyPoint solve(const std::array<std::array<double, 3>, 3>& A, size_t* pureSolves) {
-        const double inf = std::numeric_limits<double>::infinity();
-        std::array<double, 3> maxByRow {{ -inf, -inf, -inf }};
-        std::array<double, 3> minByCol {{ +inf, +inf, +inf }};
-        for(int i = 0; i < 3; ++i) {
-            for(int j = 0; j < 3; ++j) {
-                maxByRow[i] = std::max(maxByRow[i], A[i][j]);
-                minByCol[j] = std::min(minByCol[j], A[i][j]);
-            }
+static Corpus pureSaddleCorpus(size_t size, int seed) {
+    Rand rand(seed);
+    Corpus c { "pure-saddle", {}, {} };
+    for(size_t k = 0; k < size; ++k) {
+        Matrix A;
+        for(auto& row : A) for(auto& e : row) e = uniform(rand, -100, 100);
+        int r = rand.pick(3);
+        int s = rand.pick(3);
+        double v = uniform(rand, -50, 50);
+        for(int j = 0; j < 3; ++j) A[r][j] = v - uniform(rand, 0, 50);
+        for(int i = 0; i < 3; ++i) A[i][s] = v + uniform(rand, 0, 50);
+        A[r][s] = v;
+        c.matrices.push_back(A);
+        c.keys.push_back(k);
+    }
+    return c;
+}
+
+// Reservoir sample of the stage games solved during value iteration
+static Corpus shapleyCorpus(size_t size, int seed, const Rules& rules) {
+    Rand rand(seed);
+    Corpus c { "shapley", {}, {} };
+    size_t seen = 0;
+    ShapleyPlayer::forEachStageGame(rules, [&](size_t state, const Matrix& A) {
+        ++seen;
+        if(c.matrices.size() < size) {
+            c.matrices.push_back(A);
+            c.keys.push_back(state);
+            return;
         }
-        auto minValueIt = std::max_element(minByCol.begin(), minByCol.end());
-        auto maxValueIt = std::min_element(maxByRow.begin(), maxByRow.end());
-        if(*maxValueIt != *minValueIt) {
-            return solveBad(A);
+        size_t slot = (size_t)rand.pick(std::numeric_limits<int>::max()) % seen;
+        if(slot < size) {
+            c.matrices[slot] = A;
+            c.keys[slot] = state;
         }
-        if(pureSolves) ++(*pureSolves);
-        Point a {0, 0, 0};
-        Point b {0, 0, 0};
-        a.p[std::distance(maxByRow.begin(), maxValueIt)] = 1;
-        b.p[std::distance(minByCol.begin(), minValueIt)] = 1;
-        return StrategyPoint { *minValueIt, a, b };
+    });
+    return c;
+}
+
+static Corpus fileCorpus(const std::string& filename) {
+    Corpus c { "file", {}, {} };
+    std::ifstream file(filename);
+    Matrix A;
+    while(file >> A[0][0] >> A[0][1] >> A[0][2] >> A[1][0] >> A[1][1] >> A[1][2] >> A[2][0] >> A[2][1] >> A[2][2]) {
+        c.keys.push_back(c.matrices.size());
+        c.matrices.push_back(A);
     }
+    return c;
+}
 
-};
+static void dumpCorpus(const Corpus& c, const std::string& filename) {
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if(!file) {
+        fmt::print(stderr, "Unable to open {}\n", filename);
+        return;
+    }
+    for(const auto& A : c.matrices) {
+        fmt::print(file, "{} {} {} {} {} {} {} {} {}\n", A[0][0], A[0][1], A[0][2], A[1][0], A[1][1], A[1][2], A[2][0], A[2][1], A[2][2]);
+    }
+    std::fclose(file);
+}
+
+// Worst payoff the row player can be held to with strategy p, +inf if p is not a distribution
+static double guarantee(const Matrix& A, const Point& p) {
+    double sum = 0;
+    for(int i = 0; i < 3; ++i) {
+        if(p.p[i] != p.p[i] || p.p[i] < -1e-7) return std::numeric_limits<double>::infinity();
+        sum += p.p[i];
+    }
+    if(std::abs(sum - 1) > 1e-7) return std::numeric_limits<double>::infinity();
+    double value = -std::numeric_limits<double>::infinity();
+    for(int j = 0; j < 3; ++j) {
+        value = std::max(value, A[0][j]*p.p[0] + A[1][j]*p.p[1] + A[2][j]*p.p[2]);
+    }
+    return value;
+}
 
-[[maybe_unused]] static inline void printCostMatrix(const std::array<std::array<double, 3>, 3>& A) {
-    fmt::print("{:6} {:6} {:6}\n", A[0][0], A[0][1], A[0][2]);
-    fmt::print("{:6} {:6} {:6}\n", A[1][0], A[1][1], A[1][2]);
-    fmt::print("{:6} {:6} {:6}\n", A[2][0], A[2][1], A[2][2]);
+static StrategyPoint referenceSolve(const Matrix& A) {
+    std::array<double, 9> flat;
+    std::array<double, 3> x;
+    std::array<double, 3> y;
+    std::array<double, 4*7> tableau;
+    std::array<int, 3> basis;
+    for(int i = 0; i < 3; ++i) for(int j = 0; j < 3; ++j) flat[3*i+j] = A[i][j];
+    double value = MatrixGame::solveSimplex(flat.data(), 3, 3, x.data(), y.data(), tableau.data(), basis.data());
+    return StrategyPoint { value, Point{x[0], x[1], x[2]} };
 }
 
-struct SimplexSolver {
+static TimingStats computeStats(std::vector<double> samples) {
+    TimingStats stats;
+    if(samples.empty()) return stats;
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples.front();
+    size_t n = samples.size();
+    stats.median = n % 2 ? samples[n/2] : 0.5*(samples[n/2-1] + samples[n/2]);
+    for(double s : samples) stats.mean += s;
+    stats.mean /= n;
+    for(double s : samples) stats.stddev += (s - stats.mean)*(s - stats.mean);
+    stats.stddev = std::sqrt(stats.stddev / n);
+    return stats;
+}
 
-    SimplexSolver() {
-        lp = glp_create_prob();
-        glp_set_obj_dir(lp, GLP_MIN);
-        glp_add_rows(lp, 4);
-        glp_set_row_bnds(lp, 1, GLP_UP, 0.0, 0.0);
-        glp_set_row_bnds(lp, 2, GLP_UP, 0.0, 0.0);
-        glp_set_row_bnds(lp, 3, GLP_UP, 0.0, 0.0);
-        glp_set_row_bnds(lp, 4, GLP_FX, 1.0, 1.0);
-        glp_add_cols(lp, 4);
-        glp_set_col_bnds(lp, 1, GLP_LO, 0.0, 1.0);
-        glp_set_obj_coef(lp, 1, 0.0);
-        glp_set_col_bnds(lp, 2, GLP_LO, 0.0, 1.0);
-        glp_set_obj_coef(lp, 2, 0.0);
-        glp_set_col_bnds(lp, 3, GLP_LO, 0.0, 1.0);
-        glp_set_obj_coef(lp, 3, 0.0);
-        glp_set_col_bnds(lp, 4, GLP_FR, 0.0, 0.0);
-        glp_set_obj_coef(lp, 4, 1.0);
+// reset is called before every pass over the corpus, so that no pass benefits from state left by the previous one
+template<typename Solve, typename Reset>
+static PathResult runPath(const Options& options, const Corpus& corpus, const std::string& path, const std::vector<StrategyPoint>& reference, Solve&& solve, Reset&& reset) {
+    PathResult result;
+    result.corpus = corpus.name;
+    result.path = path;
+    result.size = corpus.matrices.size();
+    if(corpus.matrices.empty()) return result;
 
-        glp_init_smcp(&parm);
-        parm.meth = GLP_DUAL;
-        parm.presolve = GLP_OFF;
-        parm.r_test = GLP_RT_STD;
+    reset();
+    for(size_t k = 0; k < corpus.matrices.size(); ++k) {
+        StrategyPoint s = solve(k, corpus.matrices[k]);
+        const double ref = reference[k].value;
+        const double tolerance = 1e-6 * std::max(1.0, std::abs(ref));
+        double valueError = std::abs(s.value - ref);
+        double strategyGap = guarantee(corpus.matrices[k], s.p) - ref;
+        result.maxValueError = std::max(result.maxValueError, valueError);
+        result.maxStrategyGap = std::max(result.maxStrategyGap, strategyGap);
+        if(valueError > tolerance || strategyGap > tolerance) ++result.mismatches;
     }
 
-    ~SimplexSolver() {
-        glp_delete_prob(lp);
+    volatile double sink = 0;
+    for(int w = 0; w < options.warmup; ++w) {
+        reset();
+        for(size_t k = 0; k < corpus.matrices.size(); ++k) sink = sink + solve(k, corpus.matrices[k]).value;
+    }
+    std::vector<double> samples;
+    for(int r = 0; r < options.repetitions; ++r) {
+        reset();
+        auto begin = std::chrono::steady_clock::now();
+        for(size_t k = 0; k < corpus.matrices.size(); ++k) sink = sink + solve(k, corpus.matrices[k]).value;
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - begin).count() / corpus.matrices.size());
     }
+    result.nsPerSolve = computeStats(std::move(samples));
+    return result;
+}
 
-    glp_prob* lp;
-    glp_smcp parm;
+template<typename Solve>
+static PathResult runPath(const Options& options, const Corpus& corpus, const std::string& path, const std::vector<StrategyPoint>& reference, Solve&& solve) {
+    return runPath(options, corpus, path, reference, std::forward<Solve>(solve), []() { });
+}
 
-    struct Sol {
-        std::array<int, 4> rowstat;
-        std::array<int, 4> colstat;
-    };
-};
+static bool isSelected(const Options& options, const std::string& path) {
+    return options.paths.empty() || std::find(options.paths.begin(), options.paths.end(), path) != options.paths.end();
+}
 
-static SimplexSolver ss;
+static void benchmarkCorpus(const Options& options, const Corpus& corpus, std::vector<PathResult>* results) {
+    std::vector<StrategyPoint> reference;
+    reference.reserve(corpus.matrices.size());
+    for(const auto& A : corpus.matrices) reference.push_back(referenceSolve(A));
 
-static StrategyPoint solveSimplex(const std::array<std::array<double, 3>, 3>& A, SimplexSolver::Sol* sol, bool resolve = false) {
-    int ia[1+15], ja[1+15];
-    double ar[1+15];
-    ia[1] = 1, ja[1] = 1, ar[1] = A[0][0];
-    ia[2] = 1, ja[2] = 2, ar[2] = A[1][0];
-    ia[3] = 1, ja[3] = 3, ar[3] = A[2][0];
-    ia[4] = 1, ja[4] = 4, ar[4] = -1.0;
-    ia[5] = 2, ja[5] = 1, ar[5] = A[0][1];
-    ia[6] = 2, ja[6] = 2, ar[6] = A[1][1];
-    ia[7] = 2, ja[7] = 3, ar[7] = A[2][1];
-    ia[8] = 2, ja[8] = 4, ar[8] = -1.0;
-    ia[9] = 3, ja[9] = 1, ar[9] = A[0][2];
-    ia[10] = 3, ja[10] = 2, ar[10] = A[1][2];
-    ia[11] = 3, ja[11] = 3, ar[11] = A[2][2];
-    ia[12] = 3, ja[12] = 4, ar[12] = -1.0;
-    ia[13] = 4, ja[13] = 1, ar[13] = 1.0;
-    ia[14] = 4, ja[14] = 2, ar[14] = 1.0;
-    ia[15] = 4, ja[15] = 3, ar[15] = 1.0;
-    glp_load_matrix(ss.lp, 15, ia, ja, ar);
-    glp_term_out(GLP_OFF);
+    size_t nbKeys = corpus.keys.empty() ? 0 : 1 + *std::max_element(corpus.keys.begin(), corpus.keys.end());
 
-    if(resolve && !!sol) {
-        glp_set_row_stat(ss.lp, 1, sol->rowstat[0]);
-        glp_set_row_stat(ss.lp, 2, sol->rowstat[1]);
-        glp_set_row_stat(ss.lp, 3, sol->rowstat[2]);
-        glp_set_row_stat(ss.lp, 4, sol->rowstat[3]);
-        glp_set_col_stat(ss.lp, 1, sol->colstat[0]);
-        glp_set_col_stat(ss.lp, 2, sol->colstat[1]);
-        glp_set_col_stat(ss.lp, 3, sol->colstat[2]);
-        glp_set_col_stat(ss.lp, 4, sol->colstat[3]);
+    if(isSelected(options, "support-enumeration")) {
+        results->push_back(runPath(options, corpus, "support-enumeration", reference, [](size_t, const Matrix& A) {
+            return BilinearMinMax::solve(A);
+        }));
+    }
+    if(isSelected(options, "support-hint")) {
+        SolverContext context;
+        std::vector<SupportHint> hints(nbKeys);
+        auto reset = [&]() {
+            std::fill(hints.begin(), hints.end(), SupportHint{});
+            context.stats = SolveStats{};
+        };
+        results->push_back(runPath(options, corpus, "support-hint", reference, [&](size_t k, const Matrix& A) {
+            return BilinearMinMax::solve(A, context, &hints[corpus.keys[k]]);
+        }, reset));
+        results->back().hintHitRate = context.stats.hitRate();
+    }
+    if(isSelected(options, "glpk")) {
+        SolverContext context;
+        results->push_back(runPath(options, corpus, "glpk", reference, [&](size_t, const Matrix& A) {
+            return BilinearMinMax::solveExact(A, context);
+        }));
+    }
+    if(isSelected(options, "matrix-game")) {
+        MatrixGameSolver<3, 3> solver;
+        results->push_back(runPath(options, corpus, "matrix-game", reference, [&](size_t, const Matrix& A) {
+            auto s = solver.solve(A);
+            return StrategyPoint { s.value, Point{s.rowStrategy[0], s.rowStrategy[1], s.rowStrategy[2]} };
+        }));
     }
+    if(isSelected(options, "dense-simplex")) {
+        results->push_back(runPath(options, corpus, "dense-simplex", reference, [](size_t, const Matrix& A) {
+            return referenceSolve(A);
+        }));
+    }
+}
 
-    glp_simplex(ss.lp, &ss.parm);
-    double z = glp_get_obj_val(ss.lp);
-    double x1 = glp_get_col_prim(ss.lp, 1);
-    double x2 = glp_get_col_prim(ss.lp, 2);
-    double x3 = glp_get_col_prim(ss.lp, 3);
+// JSON has no representation for infinities or NaNs
+static std::string jsonNumber(double x) {
+    return std::isfinite(x) ? fmt::format("{}", x) : std::string("null");
+}
 
-    if(!!sol) {
-        sol->rowstat[0] = glp_get_row_stat(ss.lp, 1);
-        sol->rowstat[1] = glp_get_row_stat(ss.lp, 2);
-        sol->rowstat[2] = glp_get_row_stat(ss.lp, 3);
-        sol->rowstat[3] = glp_get_row_stat(ss.lp, 4);
-        sol->colstat[0] = glp_get_col_stat(ss.lp, 1);
-        sol->colstat[1] = glp_get_col_stat(ss.lp, 2);
-        sol->colstat[2] = glp_get_col_stat(ss.lp, 3);
-        sol->colstat[3] = glp_get_col_stat(ss.lp, 4);
+static void writeJson(const Options& options, const std::vector<PathResult>& results) {
+    std::FILE* file = std::fopen(options.jsonFile.c_str(), "w");
+    if(!file) {
+        fmt::print(stderr, "Unable to open {}\n", options.jsonFile);
+        return;
+    }
+    fmt::print(file, "{{\n  \"seed\": {},\n  \"warmup\": {},\n  \"repetitions\": {},\n  \"results\": [\n", options.seed, options.warmup, options.repetitions);
+    for(size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        fmt::print(file, "    {{\"corpus\": \"{}\", \"path\": \"{}\", \"size\": {}, "
+                         "\"ns_per_solve\": {{\"min\": {}, \"median\": {}, \"mean\": {}, \"stddev\": {}}}, "
+                         "\"mismatches\": {}, \"max_value_error\": {}, \"max_strategy_gap\": {}, \"hint_hit_rate\": {}}}{}\n",
+                   r.corpus, r.path, r.size,
+                   jsonNumber(r.nsPerSolve.min), jsonNumber(r.nsPerSolve.median), jsonNumber(r.nsPerSolve.mean), jsonNumber(r.nsPerSolve.stddev),
+                   r.mismatches, jsonNumber(r.maxValueError), jsonNumber(r.maxStrategyGap), jsonNumber(r.hintHitRate), i+1 < results.size() ? "," : "");
     }
-    
-    return StrategyPoint { z, Point{x1, x2, x3}, Point{0, 0, 0} };
+    fmt::print(file, "  ]\n}}\n");
+    std::fclose(file);
 }
 
-StrategyPoint solveBetter(const std::array<std::array<double, 3>, 3>& A, size_t* nbPure, SimplexSolver::Sol* sol, bool resolve = false) {
-    const double inf = std::numeric_limits<double>::infinity();
-    std::array<double, 3> maxByRow {{ -inf, -inf, -inf }};
-    std::array<double, 3> minByCol {{ +inf, +inf, +inf }};
-    for(int i = 0; i < 3; ++i) {
-        for(int j = 0; j < 3; ++j) {
-            maxByRow[i] = std::max(maxByRow[i], A[i][j]);
-            minByCol[j] = std::min(minByCol[j], A[i][j]);
+static bool parseOptions(int argc, char** argv, Options* options) {
+    for(int i = 1; i < argc; ++i) {
+        auto is = [&](const char* flag, int nbValues) { return !std::strcmp(argv[i], flag) && i + nbValues < argc; };
+        if(is("--size", 1)) {
+            options->size = std::atol(argv[++i]);
+        } else if(is("--seed", 1)) {
+            options->seed = std::atoi(argv[++i]);
+        } else if(is("--warmup", 1)) {
+            options->warmup = std::atoi(argv[++i]);
+        } else if(is("--repetitions", 1)) {
+            options->repetitions = std::atoi(argv[++i]);
+        } else if(is("--rules", 3)) {
+            options->rules.startLives = std::atoi(argv[++i]);
+            options->rules.maxBullets = std::atoi(argv[++i]);
+            options->rules.maxShields = std::atoi(argv[++i]);
+        } else if(is("--matrices", 1)) {
+            options->matricesFile = argv[++i];
+        } else if(is("--dump", 1)) {
+            options->dumpFile = argv[++i];
+        } else if(is("--json", 1)) {
+            options->jsonFile = argv[++i];
+        } else if(is("--paths", 1)) {
+            std::string list = argv[++i];
+            size_t begin = 0;
+            while(begin <= list.size()) {
+                size_t end = std::min(list.find(',', begin), list.size());
+                options->paths.push_back(list.substr(begin, end - begin));
+                begin = end + 1;
+            }
+        } else {
+            fmt::print(stderr, "Unknown or incomplete option {}\n", argv[i]);
+            return false;
         }
     }
-    auto minValueIt = std::max_element(minByCol.begin(), minByCol.end());
-    auto maxValueIt = std::min_element(maxByRow.begin(), maxByRow.end());
-    if(*maxValueIt == *minValueIt) {
-        if(nbPure) ++(*nbPure);
-        Point a {0, 0, 0};
-        Point b {0, 0, 0};
-        a.p[std::distance(maxByRow.begin(), maxValueIt)] = 1;
-        b.p[std::distance(minByCol.begin(), minValueIt)] = 1;
-        return StrategyPoint { *minValueIt, a, b };
-    }
-
-    return solveSimplex(A, sol, resolve);
+    return options->repetitions > 0 && options->warmup >= 0;
 }
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv) {
+int main(int argc, char** argv) {
+    Options options;
+    if(!parseOptions(argc, argv, &options)) return 2;
 
-    // size_t limit = (argc < 2 ? 1000000 : std::atoi(argv[1]));
-    std::ifstream myfile;
-    myfile.open("matrices");
-    size_t totalTime = 0;
-    size_t totalTime2 = 0;
-    size_t totalTime3 = 0;
-    size_t iterations = 0;
-    size_t pureSolves = 0;
-    size_t pureSolves2 = 0;
-    while(!myfile.eof()) {
-        std::array<std::array<double, 3>, 3> A;
-        for(int i = 0; i < 3; ++i) {
-            for(int j = 0; j < 3; ++j) {
-                double val;
-                myfile >> val;
-                A[i][j] = val;
-            }
-        }
-        std::chrono::steady_clock::time_point a = std::chrono::steady_clock::now();
-        BilinearMinMax::solve(A, &pureSolves);
-        std::chrono::steady_clock::time_point b = std::chrono::steady_clock::now();
-        SimplexSolver::Sol sol;
-        solveBetter(A, &pureSolves2, &sol, false);
-        std::chrono::steady_clock::time_point c = std::chrono::steady_clock::now();
-        solveBetter(A, &pureSolves2, &sol, true);
-        std::chrono::steady_clock::time_point d = std::chrono::steady_clock::now();
-        // if((pureSolves != pureSolves2) || (s.value != t)) {
-        //     iterations += 1;
-        //     fmt::print("{} {}\n", s.value, t);
-        //     fmt::print("approx strat={} {} {}\n", s.a.p[0], s.a.p[1], s.a.p[2]);
-        //     printCostMatrix(A);
-        // }
-        totalTime += (b-a).count();
-        totalTime2 += (c-b).count();
-        totalTime3 += (d-c).count();
-        iterations += 1;
-        // if(iterations >= limit) break;
-        if(iterations % 1000 == 0) {
-            fmt::print("{} : {} ns (~{} us per)\n", iterations, totalTime, totalTime/iterations/1000.0);
-            fmt::print("{} : {} ns (~{} us per)\n", iterations, totalTime2, totalTime2/iterations/1000.0);
-            fmt::print("{} : {} ns (~{} us per)\n", iterations, totalTime3, totalTime3/iterations/1000.0);
-            // fmt::print("{} {}\n", pureSolves, pureSolves2);
-        }
+    std::vector<Corpus> corpora;
+    corpora.push_back(randomCorpus(options.size, options.seed));
+    corpora.push_back(degenerateCorpus(options.size, options.seed + 1));
+    corpora.push_back(pureSaddleCorpus(options.size, options.seed + 2));
+    corpora.push_back(shapleyCorpus(options.size, options.seed + 3, options.rules));
+    if(!options.matricesFile.empty()) corpora.push_back(fileCorpus(options.matricesFile));
+    if(!options.dumpFile.empty()) dumpCorpus(corpora[3], options.dumpFile);
+
+    std::vector<PathResult> results;
+    for(const auto& corpus : corpora) benchmarkCorpus(options, corpus, &results);
+
+    size_t mismatches = 0;
+    fmt::print("{:12} {:20} {:>8} {:>10} {:>10} {:>10} {:>8} {:>10} {:>10} {:>9}\n", "corpus", "path", "size", "min ns", "median ns", "stddev", "errors", "max |dv|", "max gap", "hint hits");
+    for(const auto& r : results) {
+        std::string hitRate = std::isnan(r.hintHitRate) ? "-" : fmt::format("{:.1f}%", 100*r.hintHitRate);
+        fmt::print("{:12} {:20} {:8} {:10.1f} {:10.1f} {:10.1f} {:8} {:10.2e} {:10.2e} {:>9}\n",
+                   r.corpus, r.path, r.size, r.nsPerSolve.min, r.nsPerSolve.median, r.nsPerSolve.stddev,
+                   r.mismatches, r.maxValueError, r.maxStrategyGap, hitRate);
+        mismatches += r.mismatches;
     }
-}
\ No newline at end of file
+    if(!options.jsonFile.empty()) writeJson(options, results);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -1,12 +1,24 @@
 #include "capi.h"
+#include "counters.h"
+#include "gamearena.h"
 #include "player.h"
 #include "players/random.h"
 #include "players/qlearner.h"
 #include "players/bilinear.h"
 #include "players/shapley.h"
+#include "players/foreign.h"
 #include "tourney.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 extern "C" {
 
@@ -25,6 +37,18 @@ extern "C" {
         Rules rules;
     };
 
+    struct JBVecEnv {
+        JBVecEnv(const Rules& r, Player* o, int envs) : rules(r), opponent(o), states(envs), turns(envs, 0) { }
+        Rules rules;
+        Player* opponent;
+        std::vector<GameState> states;
+        std::vector<int> turns;
+        // Scratch of the batched opponent decisions
+        std::vector<PlayerState> statesA;
+        std::vector<PlayerState> statesB;
+        std::vector<Action> opponentActions;
+    };
+
     JBRules* jb_createRules(int startLives, int maxBullets, int maxShields, int maxTurns) {
         std::unique_ptr<JBRules> rules = std::make_unique<JBRules>(startLives, maxBullets, maxShields, maxTurns);
         return rules.release();
@@ -35,39 +59,168 @@ extern "C" {
         delete rules;
     }
 
-    JBPlayer* jb_createPlayer(JBPlayerType type, JBRules* rules, int seed) {
-        if(!rules) return nullptr;
-        std::unique_ptr<Player> p;
+    static constexpr int QLEARNER_WARMUP_GAMES = 100000;
+    static constexpr int QLEARNER_WARMUP_CHUNK = 1000;
+
+    // Budget, progress and cancellation of a player construction, shared with its future
+    struct Construction {
+        explicit Construction(const JBBudget& b) : budget(b), start(std::chrono::steady_clock::now()) { }
+
+        JBBudget budget;
+        std::chrono::steady_clock::time_point start;
+        std::atomic<bool> cancelled { false };
+        std::atomic<long long> steps { 0 };
+        std::atomic<long long> totalSteps { 0 };
+        std::atomic<double> residual { 0.0 };
+
+        double seconds() const {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Thread-safe, the Shapley iteration polls it from its workers
+        bool outOfBudget() const {
+            return cancelled || (budget.seconds > 0 && seconds() > budget.seconds);
+        }
+    };
+
+    static std::unique_ptr<Player> makePlayer(JBPlayerType type, const Rules& rules, int seed, Construction& construction) {
         switch(type) {
             case JBPlayerType::RANDOM: {
-                p = std::make_unique<RandomPlayer>(rules->rules, seed);
-                break;
+                return std::make_unique<RandomPlayer>(rules, seed);
             }
             case JBPlayerType::QLEARNER: {
-                p = QLearner::tryCreate(rules->rules, seed);
-                if(!p) return nullptr;
-                RandomPlayer r(!!rules ? rules->rules : Rules{}, seed+1);
+                std::unique_ptr<QLearner> q = QLearner::tryCreate(rules, seed);
+                if(!q) return nullptr;
+                const int games = construction.budget.games > 0 ? construction.budget.games : QLEARNER_WARMUP_GAMES;
+                construction.totalSteps = games;
+                RandomPlayer r(rules, seed+1);
                 Tourney::Params semiB{false, true};
-                Tourney::play2v2(100000, &r, p.get(), semiB);
-                break;
+                // In chunks, to look at the budget in between
+                for(int played = 0; played < games && !construction.outOfBudget(); ) {
+                    int chunk = std::min(games - played, QLEARNER_WARMUP_CHUNK);
+                    Tourney::play2v2(chunk, &r, q.get(), semiB);
+                    played += chunk;
+                    construction.steps = played;
+                }
+                return q;
             }
             case JBPlayerType::BILINEAR: {
-                p = std::make_unique<BilinearPlayer>(rules->rules, seed);
-                if(!p) return nullptr;
-                break;
+                return std::make_unique<BilinearPlayer>(rules, seed);
             }
             case JBPlayerType::SHAPLEY: {
-                p = ShapleyPlayer::tryCreate(rules->rules, seed);
-                if(!p) return nullptr;
-                break;
+                ShapleyPlayer::Params params = ShapleyPlayer::defaultParams();
+                if(construction.budget.iterations > 0) params.maxIterations = construction.budget.iterations;
+                construction.totalSteps = params.maxIterations;
+                params.onIteration = [&](const ShapleyPlayer::IterationReport& report) {
+                    construction.steps = report.iteration + 1;
+                    construction.residual = report.l1Residual;
+                };
+                params.interrupt = [&]() { return construction.outOfBudget(); };
+                return ShapleyPlayer::tryCreate(rules, seed, params);
             }
-            default: break;
         }
+        return nullptr;
+    }
+
+    JBPlayer* jb_createPlayer(JBPlayerType type, JBRules* rules, int seed) {
+        if(!rules) return nullptr;
+        Construction construction(JBBudget{});
+        std::unique_ptr<Player> p = makePlayer(type, rules->rules, seed, construction);
         if(!p) return nullptr;
         std::unique_ptr<JBPlayer> jbp = std::make_unique<JBPlayer>(std::move(p));
         return jbp.release();
     }
 
+    struct JBPlayerFuture {
+        JBPlayerFuture(JBPlayerType type, const Rules& rules, int seed, const JBBudget& budget) : construction(budget) {
+            worker = std::thread([this, type, rules, seed]() { run(type, rules, seed); });
+        }
+
+        ~JBPlayerFuture() {
+            construction.cancelled = true;
+            worker.join();
+        }
+
+        void run(JBPlayerType type, const Rules& rules, int seed) {
+            std::unique_ptr<Player> p;
+            // An exception must not leave the thread, it would terminate the caller's process
+            try {
+                p = makePlayer(type, rules, seed, construction);
+            } catch(...) {
+                p.reset();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            seconds = construction.seconds();
+            if(construction.cancelled) {
+                status = JBFutureStatus::FUTURE_CANCELLED;
+            } else if(!p) {
+                status = JBFutureStatus::FUTURE_FAILED;
+            } else {
+                player = std::make_unique<JBPlayer>(std::move(p));
+                status = JBFutureStatus::FUTURE_READY;
+            }
+            finished.notify_all();
+        }
+
+        Construction construction;
+        std::mutex mutex;
+        std::condition_variable finished;
+        JBFutureStatus status = JBFutureStatus::FUTURE_RUNNING;
+        double seconds = 0.0; // duration of the construction once it ended
+        std::unique_ptr<JBPlayer> player;
+        std::thread worker;
+    };
+
+    JBPlayerFuture* jb_createPlayerAsync(JBPlayerType type, JBRules* rules, int seed, const JBBudget* budget) {
+        if(!rules) return nullptr;
+        if(type < JBPlayerType::RANDOM || type > JBPlayerType::SHAPLEY) return nullptr;
+        std::unique_ptr<JBPlayerFuture> future = std::make_unique<JBPlayerFuture>(type, rules->rules, seed, budget ? *budget : JBBudget{});
+        return future.release();
+    }
+
+    void jb_destroyFuture(JBPlayerFuture* future) {
+        if(!future) return;
+        delete future;
+    }
+
+    JBError jb_futureProgress(JBPlayerFuture* future, JBProgress* progress) {
+        if(!future || !progress) return JBError::INVALID_ARGUMENT;
+        std::lock_guard<std::mutex> lock(future->mutex);
+        const Construction& construction = future->construction;
+        progress->status = future->status;
+        progress->steps = construction.steps;
+        progress->budget = construction.totalSteps;
+        progress->residual = construction.residual;
+        progress->seconds = future->status == JBFutureStatus::FUTURE_RUNNING ? construction.seconds() : future->seconds;
+        return JBError::NONE;
+    }
+
+    JBError jb_futureWait(JBPlayerFuture* future, double timeoutSeconds, JBFutureStatus* status) {
+        if(!future) return JBError::INVALID_ARGUMENT;
+        std::unique_lock<std::mutex> lock(future->mutex);
+        auto ended = [&]() { return future->status != JBFutureStatus::FUTURE_RUNNING; };
+        if(timeoutSeconds < 0) {
+            future->finished.wait(lock, ended);
+        } else {
+            future->finished.wait_for(lock, std::chrono::duration<double>(timeoutSeconds), ended);
+        }
+        if(status) *status = future->status;
+        return JBError::NONE;
+    }
+
+    JBError jb_futureCancel(JBPlayerFuture* future) {
+        if(!future) return JBError::INVALID_ARGUMENT;
+        std::lock_guard<std::mutex> lock(future->mutex);
+        if(future->status == JBFutureStatus::FUTURE_RUNNING) future->construction.cancelled = true;
+        return JBError::NONE;
+    }
+
+    JBPlayer* jb_futureTakePlayer(JBPlayerFuture* future) {
+        if(!future) return nullptr;
+        std::lock_guard<std::mutex> lock(future->mutex);
+        return future->player.release();
+    }
+
     void jb_destroyPlayer(JBPlayer* player) {
         if(!player) return;
         delete player;
@@ -110,29 +263,45 @@ extern "C" {
         return Action::Shoot;
     }
 
-    static bool isStateValid(const JBPlayerState& state, const JBRules& rules) {
-        if(state.state.lives() < 0 || state.state.lives() > rules.rules.startLives) return false;
-        if(state.state.bullets() < 0 || state.state.bullets() > rules.rules.maxBullets) return false;
-        if(state.state.remainingShields() < 0 || state.state.remainingShields() > rules.rules.maxShields) return false;
+    static bool isStateValid(const PlayerState& state, const Rules& rules) {
+        if(state.lives() < 0 || state.lives() > rules.startLives) return false;
+        if(state.bullets() < 0 || state.bullets() > rules.maxBullets) return false;
+        if(state.remainingShields() < 0 || state.remainingShields() > rules.maxShields) return false;
         return true;
     }
 
+    static bool isActionValid(JBAction a) {
+        return a >= JBAction::RELOAD && a <= JBAction::SHOOT;
+    }
+
+    static JBAction toJBAction(Action a) {
+        switch(a) {
+            case Action::Reload: return JBAction::RELOAD;
+            case Action::Shield: return JBAction::SHIELD;
+            case Action::Shoot: return JBAction::SHOOT;
+        }
+        return JBAction::SHOOT;
+    }
+
+    static PlayerState fromJBState(const JBState& s) {
+        return PlayerState::from(s.lives, s.bullets, s.remainingShields);
+    }
+
+    static JBState toJBState(const PlayerState& s) {
+        return JBState { s.lives(), s.bullets(), s.remainingShields() };
+    }
+
     JBError jb_play(JBPlayer* player, JBPlayerState* ownState, JBPlayerState* opponentState, JBRules* rules, JBAction* action) {
         if(!player) return JBError::INVALID_PLAYER;
         if(!ownState) return JBError::INVALID_STATE;
         if(!opponentState) return JBError::INVALID_STATE;
         if(!rules) return JBError::INVALID_RULES;
-        if(!isStateValid(*ownState, *rules)) return JBError::INVALID_STATE;
-        if(!isStateValid(*opponentState, *rules)) return JBError::INVALID_STATE;
+        if(!isStateValid(ownState->state, rules->rules)) return JBError::INVALID_STATE;
+        if(!isStateValid(opponentState->state, rules->rules)) return JBError::INVALID_STATE;
         PlayerState mine = ownState->state;
         PlayerState theirs = opponentState->state;
-        Action a = player->playerHandle->nextAction(mine, theirs);
-        switch(a) {
-            case Action::Reload: *action = JBAction::RELOAD; return JBError::NONE;
-            case Action::Shield: *action = JBAction::SHIELD; return JBError::NONE;
-            case Action::Shoot: *action = JBAction::SHOOT; return JBError::NONE;
-        }
-        return JBError::INVALID_ACTION;
+        *action = toJBAction(player->playerHandle->nextAction(mine, theirs));
+        return JBError::NONE;
     }
 
     JBError jb_applyActions(JBPlayer* playerA, JBPlayer* playerB, JBPlayerState* stateA, JBPlayerState* stateB, JBAction actionA, JBAction actionB) {
@@ -150,4 +319,227 @@ extern "C" {
         stateB->state = gs.stateB();
         return JBError::NONE;
     }
+
+    JBError jb_playState(JBPlayer* player, JBState ownState, JBState opponentState, JBAction* action) {
+        if(!player) return JBError::INVALID_PLAYER;
+        if(!action) return JBError::INVALID_ARGUMENT;
+        Player* p = player->playerHandle.get();
+        PlayerState mine = fromJBState(ownState);
+        PlayerState theirs = fromJBState(opponentState);
+        if(!isStateValid(mine, p->rules())) return JBError::INVALID_STATE;
+        if(!isStateValid(theirs, p->rules())) return JBError::INVALID_STATE;
+        *action = toJBAction(p->nextAction(mine, theirs));
+        return JBError::NONE;
+    }
+
+    JBError jb_applyActionsToStates(JBRules* rules, JBState* stateA, JBState* stateB, JBAction actionA, JBAction actionB) {
+        if(!rules) return JBError::INVALID_RULES;
+        if(!stateA || !stateB) return JBError::INVALID_STATE;
+        if(!isActionValid(actionA) || !isActionValid(actionB)) return JBError::INVALID_ACTION;
+        GameState gs = GameState::from(fromJBState(*stateA), fromJBState(*stateB));
+        if(!isStateValid(gs.stateA(), rules->rules)) return JBError::INVALID_STATE;
+        if(!isStateValid(gs.stateB(), rules->rules)) return JBError::INVALID_STATE;
+        gs.resolve(fromJBAction(actionA), fromJBAction(actionB), rules->rules);
+        *stateA = toJBState(gs.stateA());
+        *stateB = toJBState(gs.stateB());
+        return JBError::NONE;
+    }
+
+    JBError jb_playGames(JBPlayer* playerA, JBPlayer* playerB, int games, int allowLearningA, int allowLearningB, JBMatchResult* result, int* turns) {
+        if(!playerA) return JBError::INVALID_PLAYER;
+        if(!playerB) return JBError::INVALID_PLAYER;
+        if(!(playerA->playerHandle->rules() == playerB->playerHandle->rules())) return JBError::INVALID_RULES;
+        if(games < 0 || !result) return JBError::INVALID_ARGUMENT;
+        Tourney::Params params { !!allowLearningA, !!allowLearningB };
+        Tourney::Result r = Tourney::play2v2(games, playerA->playerHandle.get(), playerB->playerHandle.get(), params, turns);
+        result->winsA = r.winsA;
+        result->winsB = r.winsB;
+        result->ties = r.ties;
+        return JBError::NONE;
+    }
+
+    static void observe(const GameState& s, int* observation) {
+        observation[0] = s.stateA().lives();
+        observation[1] = s.stateA().bullets();
+        observation[2] = s.stateA().remainingShields();
+        observation[3] = s.stateB().lives();
+        observation[4] = s.stateB().bullets();
+        observation[5] = s.stateB().remainingShields();
+    }
+
+    JBError jb_playGamesLockstep(JBPlayer* playerA, JBPlayer* playerB, int games, int batch, int allowLearningA, int allowLearningB, JBMatchResult* result, int* turns) {
+        if(!playerA) return JBError::INVALID_PLAYER;
+        if(!playerB) return JBError::INVALID_PLAYER;
+        if(!(playerA->playerHandle->rules() == playerB->playerHandle->rules())) return JBError::INVALID_RULES;
+        if(games < 0 || batch <= 0 || !result) return JBError::INVALID_ARGUMENT;
+        Tourney::Params params { !!allowLearningA, !!allowLearningB };
+        Tourney::Result r = Tourney::play2v2Lockstep(games, batch, playerA->playerHandle.get(), playerB->playerHandle.get(), params, turns);
+        result->winsA = r.winsA;
+        result->winsB = r.winsB;
+        result->ties = r.ties;
+        return JBError::NONE;
+    }
+
+    JBPlayer* jb_createForeignPlayer(JBRules* rules, JBPolicyCallback policy, void* userData) {
+        if(!rules || !policy) return nullptr;
+        // Scratch buffers kept with the policy, which is only called by one thread at a time
+        auto observations = std::make_shared<std::vector<int>>();
+        auto jbActions = std::make_shared<std::vector<JBAction>>();
+        ForeignPlayer::Policy adapter = [=](const PlayerState* myStates, const PlayerState* opponentStates, Action* actions, size_t count) {
+            observations->resize(JB_OBSERVATION_SIZE*count);
+            for(size_t i = 0; i < count; ++i) {
+                observe(GameState::from(myStates[i], opponentStates[i]), observations->data() + JB_OBSERVATION_SIZE*i);
+            }
+            jbActions->assign(count, JBAction::RELOAD);
+            policy(userData, observations->data(), (int)count, jbActions->data());
+            for(size_t i = 0; i < count; ++i) actions[i] = fromJBAction((*jbActions)[i]);
+        };
+        std::unique_ptr<JBPlayer> jbp = std::make_unique<JBPlayer>(std::make_unique<ForeignPlayer>(rules->rules, std::move(adapter)));
+        return jbp.release();
+    }
+
+    JBVecEnv* jb_createVecEnv(JBRules* rules, JBPlayer* opponent, int envs) {
+        if(!rules || !opponent || envs <= 0) return nullptr;
+        if(!(rules->rules == opponent->playerHandle->rules())) return nullptr;
+        std::unique_ptr<JBVecEnv> env = std::make_unique<JBVecEnv>(rules->rules, opponent->playerHandle.get(), envs);
+        return env.release();
+    }
+
+    void jb_destroyVecEnv(JBVecEnv* env) {
+        if(!env) return;
+        delete env;
+    }
+
+    JBError jb_vecEnvReset(JBVecEnv* env, int* observations) {
+        if(!env) return JBError::INVALID_ARGUMENT;
+        if(!observations) return JBError::INVALID_ARGUMENT;
+        for(size_t i = 0; i < env->states.size(); ++i) {
+            // Same start as GameArena::play
+            env->states[i] = GameState{};
+            env->turns[i] = 0;
+            observe(env->states[i], observations + JB_OBSERVATION_SIZE*i);
+        }
+        return JBError::NONE;
+    }
+
+    JBError jb_vecEnvStep(JBVecEnv* env, const JBAction* actions, int* observations, float* rewards, int* dones) {
+        if(!env) return JBError::INVALID_ARGUMENT;
+        if(!actions || !observations || !rewards || !dones) return JBError::INVALID_ARGUMENT;
+        for(size_t i = 0; i < env->states.size(); ++i) {
+            if(!isActionValid(actions[i])) return JBError::INVALID_ACTION;
+        }
+        const size_t envs = env->states.size();
+        env->statesA.resize(envs);
+        env->statesB.resize(envs);
+        env->opponentActions.resize(envs);
+        for(size_t i = 0; i < envs; ++i) {
+            env->statesA[i] = env->states[i].stateA();
+            env->statesB[i] = env->states[i].stateB();
+        }
+        env->opponent->nextActions(env->statesB.data(), env->statesA.data(), env->opponentActions.data(), envs);
+        for(size_t i = 0; i < envs; ++i) {
+            GameState& s = env->states[i];
+            bool done = !GameArena::playTurn(&s, &env->turns[i], fromJBAction(actions[i]), env->opponentActions[i], env->rules);
+            rewards[i] = 0.0f;
+            dones[i] = done;
+            if(done) {
+                rewards[i] = (float)GameArena::endGame(s, env->turns[i]);
+                s = GameState{};
+                env->turns[i] = 0;
+            }
+            observe(s, observations + JB_OBSERVATION_SIZE*i);
+        }
+        return JBError::NONE;
+    }
+    JBError jb_qlearnerTable(JBPlayer* player, JBAction action, JBQTable table, JBTableView* view) {
+        if(!player) return JBError::INVALID_PLAYER;
+        const QLearner* q = dynamic_cast<const QLearner*>(player->playerHandle.get());
+        if(!q) return JBError::INVALID_PLAYER;
+        if(!isActionValid(action)) return JBError::INVALID_ACTION;
+        if(!view) return JBError::INVALID_ARGUMENT;
+        const auto& scores = q->scores(fromJBAction(action));
+        using Score = std::decay_t<decltype(scores)>::value_type;
+        const char* data = reinterpret_cast<const char*>(scores.data());
+        switch(table) {
+            case JBQTable::QSCORE: {
+                view->data = data + offsetof(Score, score);
+                view->type = JBScalarType::FLOAT64;
+                break;
+            }
+            case JBQTable::QCONFIDENCE: {
+                view->data = data + offsetof(Score, confidence);
+                view->type = JBScalarType::INT32;
+                break;
+            }
+            default: return JBError::INVALID_ARGUMENT;
+        }
+        view->ndim = 2;
+        view->shape[0] = QLearner::STATES_PER_PLAYER;
+        view->shape[1] = QLearner::STATES_PER_PLAYER;
+        view->strides[0] = QLearner::STATES_PER_PLAYER*sizeof(Score);
+        view->strides[1] = sizeof(Score);
+        return JBError::NONE;
+    }
+
+    static const ShapleyPlayer* asShapley(JBPlayer* player) {
+        if(!player) return nullptr;
+        return dynamic_cast<const ShapleyPlayer*>(player->playerHandle.get());
+    }
+
+    JBError jb_shapleyTable(JBPlayer* player, JBShapleyTable table, JBTableView* view) {
+        const ShapleyPlayer* s = asShapley(player);
+        if(!s) return JBError::INVALID_PLAYER;
+        if(!view) return JBError::INVALID_ARGUMENT;
+        ShapleyPlayer::Tables tables = s->tables();
+        long long scalarSize = tables.singlePrecision ? sizeof(float) : sizeof(double);
+        JBScalarType scalarType = tables.singlePrecision ? JBScalarType::FLOAT32 : JBScalarType::FLOAT64;
+        switch(table) {
+            case JBShapleyTable::SHAPLEY_VALUES: {
+                *view = JBTableView { tables.values, scalarType, 1, { (long long)tables.nodes, 0 }, { scalarSize, 0 } };
+                return JBError::NONE;
+            }
+            case JBShapleyTable::SHAPLEY_THRESHOLDS: {
+                *view = JBTableView { tables.thresholds, scalarType, 2, { (long long)tables.nodes, 3 }, { 3*scalarSize, scalarSize } };
+                return JBError::NONE;
+            }
+            case JBShapleyTable::SHAPLEY_STATES: {
+                *view = JBTableView { tables.stateBitmap, JBScalarType::UINT64, 1, { (long long)tables.stateBitmapWords, 0 }, { sizeof(uint64_t), 0 } };
+                return JBError::NONE;
+            }
+        }
+        return JBError::INVALID_ARGUMENT;
+    }
+
+    JBError jb_shapleyBounds(JBPlayer* player, int* maxLives, int* maxBullets, int* maxShields) {
+        const ShapleyPlayer* s = asShapley(player);
+        if(!s) return JBError::INVALID_PLAYER;
+        if(!maxLives || !maxBullets || !maxShields) return JBError::INVALID_ARGUMENT;
+        ShapleyPlayer::Tables tables = s->tables();
+        *maxLives = tables.maxLives;
+        *maxBullets = tables.maxBullets;
+        *maxShields = tables.maxShields;
+        return JBError::NONE;
+    }
+
+    static_assert(JB_NB_COUNTERS == NB_COUNTERS, "JBCounter mirrors Counter");
+
+    int jb_countersEnabled() {
+        return Counters::enabled;
+    }
+
+    JBError jb_readCounters(unsigned long long* values, int count) {
+        if(!values || count < 0) return JBError::INVALID_ARGUMENT;
+        CounterValues snapshot = Counters::snapshot();
+        for(int c = 0; c < std::min(count, (int)JB_NB_COUNTERS); ++c) values[c] = snapshot[c];
+        return JBError::NONE;
+    }
+
+    void jb_resetCounters() {
+        Counters::reset();
+    }
+
+    const char* jb_counterName(JBCounter counter) {
+        if((int)counter < 0 || (int)counter >= JB_NB_COUNTERS) return nullptr;
+        return Counters::name((Counter)counter);
+    }
 }
\ No newline at end of file
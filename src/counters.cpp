@@ -0,0 +1,84 @@
+#include "counters.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+struct ThreadCounters;
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> threads;
+    CounterValues exited {};   // sum of the threads that exited
+    CounterValues baseline {}; // sum of all threads at the last reset
+};
+
+// Never destroyed, threads may exit after static destruction began
+static Registry& registry() {
+    static Registry* registry = new Registry;
+    return *registry;
+}
+
+struct ThreadCounters {
+    std::array<std::atomic<uint64_t>, NB_COUNTERS> values {};
+
+    ThreadCounters() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(this);
+    }
+
+    ~ThreadCounters() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for(int c = 0; c < NB_COUNTERS; ++c) r.exited[c] += values[c].load(std::memory_order_relaxed);
+        r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+    }
+};
+
+// Requires the registry lock
+static CounterValues total(const Registry& r) {
+    CounterValues values = r.exited;
+    for(const ThreadCounters* thread : r.threads) {
+        for(int c = 0; c < NB_COUNTERS; ++c) values[c] += thread->values[c].load(std::memory_order_relaxed);
+    }
+    return values;
+}
+
+Counters::Block* Counters::local() {
+    thread_local ThreadCounters counters;
+    return &counters.values;
+}
+
+CounterValues Counters::snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    CounterValues values = total(r);
+    for(int c = 0; c < NB_COUNTERS; ++c) values[c] -= r.baseline[c];
+    return values;
+}
+
+void Counters::reset() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.baseline = total(r);
+}
+
+const char* Counters::name(Counter counter) {
+    switch(counter) {
+        case Counter::TurnsSimulated: return "turns_simulated";
+        case Counter::GamesWonA: return "games_won_a";
+        case Counter::GamesWonB: return "games_won_b";
+        case Counter::GamesTied: return "games_tied";
+        case Counter::GamesAtTurnLimit: return "games_at_turn_limit";
+        case Counter::PureSolves: return "pure_solves";
+        case Counter::MixedSolves: return "mixed_solves";
+        case Counter::TranspositionHits: return "transposition_hits";
+        case Counter::TranspositionMisses: return "transposition_misses";
+        case Counter::PolicyHits: return "policy_hits";
+        case Counter::PolicyMisses: return "policy_misses";
+        case Counter::PolicyFileHits: return "policy_file_hits";
+        case Counter::PolicyFileMisses: return "policy_file_misses";
+        case Counter::RecordingsReplayed: return "recordings_replayed";
+    }
+    return "";
+}
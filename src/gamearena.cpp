@@ -1,5 +1,6 @@
 #include "gamearena.h"
 #include "gamerecording.h"
+#include "counters.h"
 #include "fmt/core.h"
 #include <string>
 
@@ -11,20 +12,38 @@ const Player* GameArena::play(Player* a, Player* b, GameRecording* recording) {
     if(!(a->rules() == b->rules())) return nullptr;
     const Rules& rules = a->rules();
     state_ = GameState{};
-    int turns = 0;
+    turns_ = 0;
     if(recording) recording->clear();
-    while(!state_.gameOver() && turns < rules.maxTurns) {
-        ++turns;
+    bool running = turns_ < rules.maxTurns;
+    while(running) {
         Action actionA = a->nextAction(state_.stateA(), state_.stateB());
         Action actionB = b->nextAction(state_.stateB(), state_.stateA());
         if(recording) recording->record(actionA, actionB);
-        state_.resolve(actionA, actionB, rules);
+        running = playTurn(&state_, &turns_, actionA, actionB, rules);
     }
-	const Player* winner = state_.winner(a, b);
-	if(recording) recording->recordWinner(winner);
+    const Player* winner = endGame(state_, turns_, a, b);
+    if(recording) recording->recordWinner(winner);
     return winner;
 }
 
+bool GameArena::playTurn(GameState* state, int* turns, Action actionA, Action actionB, const Rules& rules) {
+    state->resolve(actionA, actionB, rules);
+    ++*turns;
+    return !state->gameOver() && *turns < rules.maxTurns;
+}
+
+int GameArena::endGame(const GameState& state, int turns) {
+    int outcome = state.outcome();
+    Counters::add(Counter::TurnsSimulated, turns);
+    Counters::add(outcome > 0 ? Counter::GamesWonA : outcome < 0 ? Counter::GamesWonB : Counter::GamesTied);
+    if(!state.gameOver()) Counters::add(Counter::GamesAtTurnLimit);
+    return outcome;
+}
+
+const Player* GameArena::endGame(const GameState& state, int turns, const Player* a, const Player* b) {
+    return GameState::fromOutcome(endGame(state, turns), a, b);
+}
+
 static std::string toString(Action action) {
     switch(action) {
         case Action::Reload: return "reload";
@@ -0,0 +1,137 @@
+#include "matrixgame.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+bool MatrixGame::solvePure(const double* A, int m, int n, double* x, double* y, double* value) {
+    const double inf = std::numeric_limits<double>::infinity();
+    double minimax = +inf;
+    double maximin = -inf;
+    int bestRow = 0;
+    int bestCol = 0;
+    for(int i = 0; i < m; ++i) {
+        double maxOfRow = -inf;
+        for(int j = 0; j < n; ++j) maxOfRow = std::max(maxOfRow, A[i*n+j]);
+        if(maxOfRow < minimax) {
+            minimax = maxOfRow;
+            bestRow = i;
+        }
+    }
+    for(int j = 0; j < n; ++j) {
+        double minOfCol = +inf;
+        for(int i = 0; i < m; ++i) minOfCol = std::min(minOfCol, A[i*n+j]);
+        if(minOfCol > maximin) {
+            maximin = minOfCol;
+            bestCol = j;
+        }
+    }
+    if(minimax != maximin) return false;
+    std::fill(x, x+m, 0.0);
+    std::fill(y, y+n, 0.0);
+    x[bestRow] = 1;
+    y[bestCol] = 1;
+    *value = minimax;
+    return true;
+}
+
+// Only valid for games without a saddle point, where the denominator cannot vanish
+void MatrixGame::solve2x2(const double* A, double* x, double* y, double* value) {
+    double d = A[0] - A[1] - A[2] + A[3];
+    assert(d != 0);
+    x[0] = (A[3] - A[2]) / d;
+    x[1] = (A[0] - A[1]) / d;
+    y[0] = (A[3] - A[1]) / d;
+    y[1] = (A[0] - A[2]) / d;
+    *value = (A[0]*A[3] - A[1]*A[2]) / d;
+}
+
+// Classic reduction of a matrix game to a linear program: with P = shift - A > 0, the maximizer
+// of P gets 1/max{sum w : P w <= 1, w >= 0}. The slack basis is feasible, so no phase 1 is needed,
+// and the row strategy is read from the reduced costs of the slacks.
+double MatrixGame::solveSimplex(const double* A, int m, int n, double* x, double* y, double* tableau, int* basis) {
+    double maxA = -std::numeric_limits<double>::infinity();
+    double minA = +std::numeric_limits<double>::infinity();
+    for(int k = 0; k < m*n; ++k) {
+        maxA = std::max(maxA, A[k]);
+        minA = std::min(minA, A[k]);
+    }
+    const double shift = maxA + std::max(1.0, maxA - minA);
+    const int width = n + m + 1;
+    const int rhs = n + m;
+    auto T = [&](int i, int j) -> double& { return tableau[i*width + j]; };
+
+    std::fill(tableau, tableau + tableauSize(m, n), 0.0);
+    for(int i = 0; i < m; ++i) {
+        for(int j = 0; j < n; ++j) T(i, j) = shift - A[i*n+j];
+        T(i, n+i) = 1.0;
+        T(i, rhs) = 1.0;
+        basis[i] = n+i;
+    }
+    for(int j = 0; j < n; ++j) T(m, j) = -1.0;
+
+    const double eps = 1e-12;
+    // Dantzig's rule converges fastest in practice, Bland's rule afterwards guarantees termination
+    const int dantzigPivots = 50*(m+n);
+    for(int pivots = 0; ; ++pivots) {
+        int e = -1;
+        double mostNegative = -eps;
+        for(int j = 0; j < n+m; ++j) {
+            if(T(m, j) < mostNegative) {
+                e = j;
+                if(pivots >= dantzigPivots) break;
+                mostNegative = T(m, j);
+            }
+        }
+        if(e < 0) break;
+        int r = -1;
+        double bestRatio = std::numeric_limits<double>::infinity();
+        for(int i = 0; i < m; ++i) {
+            if(T(i, e) <= eps) continue;
+            double ratio = T(i, rhs) / T(i, e);
+            if(ratio < bestRatio || (ratio == bestRatio && basis[i] < basis[r])) {
+                bestRatio = ratio;
+                r = i;
+            }
+        }
+        if(r < 0) break;
+        double pivot = T(r, e);
+        for(int j = 0; j < width; ++j) T(r, j) /= pivot;
+        for(int i = 0; i <= m; ++i) {
+            if(i == r) continue;
+            double f = T(i, e);
+            if(f == 0) continue;
+            for(int j = 0; j < width; ++j) T(i, j) -= f * T(r, j);
+        }
+        basis[r] = e;
+    }
+
+    double v = 1.0 / T(m, rhs);
+    std::fill(y, y+n, 0.0);
+    for(int i = 0; i < m; ++i) {
+        if(basis[i] < n) y[basis[i]] = T(i, rhs) * v;
+    }
+    for(int i = 0; i < m; ++i) x[i] = T(m, n+i) * v;
+    return shift - v;
+}
+
+void MatrixGame::solve(const double* A, int m, int n, double* x, double* y, double* value, double* tableau, int* basis) {
+    assert(m > 0 && n > 0);
+    if(solvePure(A, m, n, x, y, value)) return;
+    if(m == 2 && n == 2) {
+        solve2x2(A, x, y, value);
+        return;
+    }
+    *value = solveSimplex(A, m, n, x, y, tableau, basis);
+}
+
+MatrixGameSolution<DYNAMIC_SIZE, DYNAMIC_SIZE> MatrixGameSolver<DYNAMIC_SIZE, DYNAMIC_SIZE>::solve(const std::vector<double>& A, int m, int n) {
+    assert(A.size() == (size_t)m*n);
+    Solution solution;
+    solution.rowStrategy.resize(m);
+    solution.columnStrategy.resize(n);
+    if(tableau_.size() < MatrixGame::tableauSize(m, n)) tableau_.resize(MatrixGame::tableauSize(m, n));
+    if(basis_.size() < (size_t)m) basis_.resize(m);
+    MatrixGame::solve(A.data(), m, n, solution.rowStrategy.data(), solution.columnStrategy.data(), &solution.value, tableau_.data(), basis_.data());
+    return solution;
+}
@@ -1,6 +1,9 @@
 #include "players/bilinear.h"
 #include "bilinearminmax.h"
+#include "counters.h"
 #include <array>
+#include <mutex>
+#include <utility>
 
 static double playerStateValue(const Rules& rules, const PlayerState& s) {
     return (rules.maxShields+1)*((rules.maxBullets+1)*s.lives() + s.bullets()) + s.remainingShields();
@@ -11,31 +14,161 @@ static double gameStateValue(const Rules& rules, const GameState& s) {
     return playerStateValue(rules, s.stateB()) - playerStateValue(rules, s.stateA());
 }
 
-Action BilinearPlayer::nextAction(const PlayerState& myState, const PlayerState& opponentState) {
-    GameState s = GameState::from(myState, opponentState);
-    const Player* opponent = this+0x100;
+// Above this many entries the table is not worth its memory
+static constexpr size_t MAX_POLICY_ENTRIES = 1 << 20;
+
+// Stage game of s for A: the change of gameStateValue, or -1000/+1000/0 when the game ends.
+// successorValue(t) is added for every state t in which the game goes on, in action order.
+template<typename SuccessorValue>
+static std::array<std::array<double, 3>, 3> stagePayoff(const Rules& rules, const GameState& s, SuccessorValue&& successorValue) {
     std::array<std::array<double, 3>, 3> payoff;
     for(int a = 0; a < 3; ++a) {
         for(int b = 0; b < 3; ++b) {
             GameState t = s;
-            t.resolve((Action)a, (Action)b, rules_);
+            t.resolve((Action)a, (Action)b, rules);
             if(t.gameOver()) {
-                const Player* winner = t.winner(this, opponent);
-                if(winner == this) {
+                if(t.stateA().lives() > 0) {
                     payoff[a][b] = -1000;
-                } else if(winner == opponent) {
+                } else if(t.stateB().lives() > 0) {
                     payoff[a][b] = +1000;
                 } else {
                     payoff[a][b] = 0.0;
                 }
             } else {
-                payoff[a][b] = gameStateValue(rules_, t) - gameStateValue(rules_, s);
+                payoff[a][b] = gameStateValue(rules, t) - gameStateValue(rules, s) + successorValue(t);
             }
         }
     }
-    auto strategy = BilinearMinMax::solve(payoff);
-    Action preferredAction = actionWithBias(rand_, strategy.p.p[0], strategy.p.p[1], strategy.p.p[2]);
+    return payoff;
+}
+
+Point BilinearPolicy::computeStrategy(const Rules& rules, const PlayerState& myState, const PlayerState& opponentState) {
+    GameState s = GameState::from(myState, opponentState);
+    return BilinearMinMax::solve(stagePayoff(rules, s, [](const GameState&) { return 0.0; })).p;
+}
+
+BilinearPolicy::BilinearPolicy(const Rules& rules) : maxLives_(maxLives(rules)), maxBullets_(rules.maxBullets), maxShields_(maxShields(rules)) {
+    statesPerPlayer_ = maxLives_*(maxBullets_+1)*(maxShields_+1);
+    strategies_.resize((size_t)statesPerPlayer_*statesPerPlayer_);
+    for(int lives = 1; lives <= maxLives_; ++lives) {
+        for(int bullets = 0; bullets <= maxBullets_; ++bullets) {
+            for(int shields = 0; shields <= maxShields_; ++shields) {
+                PlayerState me = PlayerState::from(lives, bullets, shields);
+                for(int opponentLives = 1; opponentLives <= maxLives_; ++opponentLives) {
+                    for(int opponentBullets = 0; opponentBullets <= maxBullets_; ++opponentBullets) {
+                        for(int opponentShields = 0; opponentShields <= maxShields_; ++opponentShields) {
+                            PlayerState opponent = PlayerState::from(opponentLives, opponentBullets, opponentShields);
+                            strategies_[(size_t)stateIndex(me)*statesPerPlayer_ + stateIndex(opponent)] = computeStrategy(rules, me, opponent);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::shared_ptr<const BilinearPolicy> BilinearPolicy::forRules(const Rules& rules) {
+    if(rules.startLives < 1 || rules.maxBullets < 0 || rules.maxShields < 0) return {};
+    size_t statesPerPlayer = (size_t)maxLives(rules)*(rules.maxBullets+1)*(maxShields(rules)+1);
+    if(statesPerPlayer*statesPerPlayer > MAX_POLICY_ENTRIES) return {};
+
+    static std::mutex registryMutex;
+    static std::vector<std::pair<Rules, std::weak_ptr<const BilinearPolicy>>> registry;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for(auto& entry : registry) {
+        if(!(entry.first == rules)) continue;
+        if(auto policy = entry.second.lock()) return policy;
+        auto policy = std::make_shared<const BilinearPolicy>(rules);
+        entry.second = policy;
+        return policy;
+    }
+    auto policy = std::make_shared<const BilinearPolicy>(rules);
+    registry.emplace_back(rules, policy);
+    return policy;
+}
+
+BilinearPlayer::BilinearPlayer(const Rules& rules, int seed, const Params& params) :
+        Player(rules), rand_(seed), policy_(BilinearPolicy::forRules(rules)), params_(params) {
+    if(params_.depth > 1) {
+        size_t entries = 2;
+        while(entries < params_.transpositionEntries) entries *= 2;
+        transpositions_.resize(entries);
+    }
+}
+
+// Lives, bullets and shields of both players, 10 bits each
+static uint64_t transpositionKey(const GameState& s) {
+    uint64_t key = 0;
+    for(const PlayerState* p : { &s.stateA(), &s.stateB() }) {
+        key = (key << 10) | (uint64_t)p->lives();
+        key = (key << 10) | (uint64_t)p->bullets();
+        key = (key << 10) | (uint64_t)p->remainingShields();
+    }
+    return key;
+}
+
+// Same matrix as computeStrategy, plus the searched value of every successor at depth-1
+StrategyPoint BilinearPlayer::solveStage(const GameState& s, int depth) {
+    return BilinearMinMax::solve(stagePayoff(rules_, s, [&](const GameState& t) { return depth > 1 ? searchValue(t, depth-1) : 0.0; }));
+}
+
+double BilinearPlayer::searchValue(const GameState& s, int depth) {
+    if(aborted_) return 0.0;
+    ++lastSearch_.nodes;
+    if((++searchedNodes_ & 1023) == 0 && std::chrono::steady_clock::now() > deadline_) {
+        aborted_ = true;
+        return 0.0;
+    }
+    uint64_t key = transpositionKey(s);
+    // Buckets of two entries: the first keeps the deepest value, the second the latest one
+    TranspositionEntry* bucket = &transpositions_[(key * 0x9E3779B97F4A7C15ull >> 32) & (transpositions_.size() - 2)];
+    // A deeper value is at least as good as the one asked for
+    for(int i = 0; i < 2; ++i) {
+        if(bucket[i].key == key && bucket[i].depth >= depth) {
+            Counters::add(Counter::TranspositionHits);
+            ++lastSearch_.transpositionHits;
+            return bucket[i].value;
+        }
+    }
+    Counters::add(Counter::TranspositionMisses);
+    double value = solveStage(s, depth).value;
+    if(aborted_) return 0.0;
+    if(depth >= bucket[0].depth || bucket[0].key == key) {
+        if(bucket[0].key != key) bucket[1] = bucket[0];
+        bucket[0] = TranspositionEntry { key, depth, value };
+    } else {
+        bucket[1] = TranspositionEntry { key, depth, value };
+    }
+    return value;
+}
+
+// Iterative deepening, so that the time budget always leaves a complete search to play
+Point BilinearPlayer::searchStrategy(const PlayerState& myState, const PlayerState& opponentState) {
+    const Point* cached = policy_ ? policy_->lookup(myState, opponentState) : nullptr;
+    Counters::add(cached ? Counter::PolicyHits : Counter::PolicyMisses);
+    Point strategy = cached ? *cached : BilinearPolicy::computeStrategy(rules_, myState, opponentState);
+    lastSearch_ = SearchStats{};
+    if(params_.depth <= 1) return strategy;
+    deadline_ = params_.timeBudget > 0
+        ? std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(params_.timeBudget))
+        : std::chrono::steady_clock::time_point::max();
+    aborted_ = false;
+    GameState root = GameState::from(myState, opponentState);
+    for(int depth = 2; depth <= params_.depth; ++depth) {
+        // Nodes only look at the clock now and then, a spent budget starts no deeper search
+        if(std::chrono::steady_clock::now() > deadline_) break;
+        StrategyPoint solution = solveStage(root, depth);
+        if(aborted_) break;
+        strategy = solution.p;
+        lastSearch_.depth = depth;
+    }
+    return strategy;
+}
+
+Action BilinearPlayer::nextAction(const PlayerState& myState, const PlayerState& opponentState) {
+    Point strategy = searchStrategy(myState, opponentState);
+    Action preferredAction = actionWithBias(rand_, strategy.p[0], strategy.p[1], strategy.p[2]);
     if(myState.isLegalAction(preferredAction, rules_)) return preferredAction;
     return myState.randomAllowedAction(&rand_, rules_);
 
-}
\ No newline at end of file
+}
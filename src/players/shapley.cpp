@@ -1,12 +1,25 @@
 #include "players/shapley.h"
 #include "gamestate.h"
 #include "bilinearminmax.h"
+#include "counters.h"
+#include "threadpool.h"
 #include "fmt/core.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <set>
-#include <deque>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <memory>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 class DummyPlayer : public Player {
 public:
@@ -16,63 +29,96 @@ private:
     void learnFromGame(const GameRecording&) { }
 };
 
-static constexpr ssize_t AWIN = -1;
-static constexpr ssize_t BWIN = -2;
-static constexpr ssize_t TIE = -3;
+static constexpr int32_t AWIN = -1;
+static constexpr int32_t BWIN = -2;
+static constexpr int32_t TIE = -3;
 
-struct GameGraph {
+// Packing of the non-terminal states within bounds that cover every reachable state.
+// The bounds may exceed the Rules since games always start from the default GameState.
+struct StateIndexer {
+    int maxLives = 0;
+    int maxBullets = 0;
+    int maxShields = 0;
+
+    size_t statesPerPlayer() const {
+        return (size_t)maxLives*(maxBullets+1)*(maxShields+1);
+    }
+
+    size_t nbKeys() const { return statesPerPlayer()*statesPerPlayer(); }
+
+    // Only non-terminal states are indexed, so lives start at 1
+    ssize_t packedIndex(const PlayerState& s) const {
+        if(s.lives() < 1 || s.lives() > maxLives) return -1;
+        if(s.bullets() < 0 || s.bullets() > maxBullets) return -1;
+        if(s.remainingShields() < 0 || s.remainingShields() > maxShields) return -1;
+        return ((ssize_t)(s.lives()-1)*(maxBullets+1) + s.bullets())*(maxShields+1) + s.remainingShields();
+    }
+
+    ssize_t packedKey(const PlayerState& sa, const PlayerState& sb) const {
+        ssize_t ia = packedIndex(sa);
+        ssize_t ib = packedIndex(sb);
+        if(ia < 0 || ib < 0) return -1;
+        return ia*(ssize_t)statesPerPlayer() + ib;
+    }
+
+    PlayerState unpackIndex(size_t index) const {
+        int shields = (int)(index % (maxShields+1));
+        index /= (maxShields+1);
+        int bullets = (int)(index % (maxBullets+1));
+        int lives = (int)(index / (maxBullets+1)) + 1;
+        return PlayerState::from(lives, bullets, shields);
+    }
+
+    GameState unpackKey(size_t key) const {
+        return GameState::from(unpackIndex(key / statesPerPlayer()), unpackIndex(key % statesPerPlayer()));
+    }
+};
+
+// Reachable non-terminal states as a bitmap over the packed keys. A node id is the rank of
+// its key among the states present, so nodes are numbered in packed order (lives-major,
+// player A first). The bitmap and the running counts take 1.5 bits per key.
+struct StateSet : StateIndexer {
+    std::vector<uint64_t> words;
+    std::vector<uint32_t> ranks; // number of states before each word
+
+    size_t size() const { return nbNodes; }
+
+    ssize_t find(const PlayerState& sa, const PlayerState& sb) const {
+        ssize_t key = packedKey(sa, sb);
+        if(key < 0) return -1;
+        return nodeOf(words.data(), ranks.data(), key);
+    }
+
+    static ssize_t nodeOf(const uint64_t* words, const uint32_t* ranks, size_t key) {
+        uint64_t word = words[key / 64];
+        uint64_t bit = uint64_t(1) << (key % 64);
+        if(!(word & bit)) return -1;
+        return ranks[key / 64] + __builtin_popcountll(word & (bit - 1));
+    }
+
+    size_t nbNodes = 0;
+};
+
+struct GameGraph : StateSet {
     explicit GameGraph(const Rules& rules) : a(rules), b(rules) { }
 
     DummyPlayer a;
     DummyPlayer b;
-    std::vector<GameState> states;
     ssize_t entrypoint;
-    std::vector<std::array<std::array<ssize_t, 3>, 3>> edges;
-    std::vector<std::array<std::array<double, 3>, 3>> edgesCost;
-};
 
-struct StateComparator {
-    bool operator()(const GameState& s, const GameState& t) const {
-        std::array<int, 6> vs {
-            s.stateA().lives(),
-            s.stateA().bullets(),
-            s.stateA().remainingShields(),
-            s.stateB().lives(),
-            s.stateB().bullets(),
-            s.stateB().remainingShields(),
-        };
-        std::array<int, 6> vt {
-            t.stateA().lives(),
-            t.stateA().bullets(),
-            t.stateA().remainingShields(),
-            t.stateB().lives(),
-            t.stateB().bullets(),
-            t.stateB().remainingShields(),
-        };
-        return std::lexicographical_compare(vs.begin(), vs.end(), vt.begin(), vt.end());
-    }
-};
+    // Packed (stateA, stateB) of every node
+    std::vector<uint64_t> keys;
 
-struct StateComparator2 {
-    bool operator()(const GameState& s, const std::pair<PlayerState, PlayerState>& t) const {
-        std::array<int, 6> vs {
-            s.stateA().lives(),
-            s.stateA().bullets(),
-            s.stateA().remainingShields(),
-            s.stateB().lives(),
-            s.stateB().bullets(),
-            s.stateB().remainingShields(),
-        };
-        std::array<int, 6> vt {
-            t.first.lives(),
-            t.first.bullets(),
-            t.first.remainingShields(),
-            t.second.lives(),
-            t.second.bullets(),
-            t.second.remainingShields(),
-        };
-        return std::lexicographical_compare(vs.begin(), vs.end(), vt.begin(), vt.end());
-    }
+    // Fixed-degree CSR: the 9 outgoing edges of node i start at 9*i, indexed by 3*a+b.
+    // Successors are node ids or one of AWIN, BWIN, TIE; costs are integers or +-inf,
+    // so storing them as float is exact.
+    std::vector<int32_t> successors;
+    std::vector<float> costs;
+
+    int32_t successor(size_t i, int a, int b) const { return successors[9*i + 3*a + b]; }
+    float cost(size_t i, int a, int b) const { return costs[9*i + 3*a + b]; }
+
+    GameState state(size_t i) const { return unpackKey(keys[i]); }
 };
 
 static double playerStateValue(const Rules& rules, const PlayerState& s) {
@@ -89,71 +135,105 @@ static double gameStateValue(const Rules& rules, const GameState& s) {
     return gameStateValue(rules, s.stateA(), s.stateB());
 }
 
-static std::unique_ptr<GameGraph> make_graph(const Rules& rules) {
-    GameGraph graph(rules);
+// Fills the set with the non-terminal states reachable from the default GameState
+static bool discoverStates(const Rules& rules, StateSet& set) {
+    // Lives and shields only decrease from their starting values, or get reset to maxShields,
+    // and bullets never exceed maxBullets: this bounds every reachable state.
+    GameState start;
+    for(const PlayerState* p : { &start.stateA(), &start.stateB() }) {
+        set.maxLives = std::max({ set.maxLives, rules.startLives, p->lives() });
+        set.maxBullets = std::max({ set.maxBullets, rules.maxBullets, p->bullets() });
+        set.maxShields = std::max({ set.maxShields, rules.maxShields, p->remainingShields() });
+    }
+    ssize_t startKey = set.packedKey(start.stateA(), start.stateB());
+    if(startKey < 0) return false;
 
-    std::set<GameState, StateComparator> visitedStates;
-    std::deque<GameState> stateQueue;
-    stateQueue.push_back(GameState{});
     std::array<Action, 3> actions { Action::Reload, Action::Shield, Action::Shoot };
-    while(!stateQueue.empty()) {
-        GameState s = stateQueue.back();
-        stateQueue.pop_back();
-        visitedStates.emplace(s);
+
+    // Depth-first discovery, states are marked when first seen so that each is pushed once
+    set.words.assign((set.nbKeys() + 63) / 64, 0);
+    std::vector<uint64_t> stack;
+    set.words[startKey / 64] |= uint64_t(1) << (startKey % 64);
+    stack.push_back(startKey);
+    while(!stack.empty()) {
+        GameState s = set.unpackKey(stack.back());
+        stack.pop_back();
         for(Action a : actions) {
             for(Action b : actions) {
                 GameState t = s;
                 t.resolve(a, b, rules);
                 if(t.gameOver()) continue;
-                if(visitedStates.find(t) != visitedStates.end()) continue;
-                stateQueue.push_back(t);
+                ssize_t key = set.packedKey(t.stateA(), t.stateB());
+                if(key < 0) {
+                    fmt::print("Error in transition table\n");
+                    return false;
+                }
+                uint64_t bit = uint64_t(1) << (key % 64);
+                if(set.words[key / 64] & bit) continue;
+                set.words[key / 64] |= bit;
+                stack.push_back(key);
             }
         }
     }
-    // fmt::print("Game has {} non-terminal states\n", visitedStates.size());
 
-    graph.states.insert(graph.states.begin(), visitedStates.begin(), visitedStates.end());
-    std::sort(graph.states.begin(), graph.states.end(), StateComparator{});
-    for(const auto& s : graph.states) {
-        auto& edgesTable = graph.edges.emplace_back();
-        auto& edgesCostTable = graph.edgesCost.emplace_back();
+    set.ranks.resize(set.words.size());
+    size_t count = 0;
+    for(size_t w = 0; w < set.words.size(); ++w) {
+        set.ranks[w] = (uint32_t)count;
+        count += __builtin_popcountll(set.words[w]);
+        if(count > (size_t)std::numeric_limits<int32_t>::max()) return false;
+    }
+    set.nbNodes = count;
+    // fmt::print("Game has {} non-terminal states\n", count);
+    return true;
+}
+
+static std::unique_ptr<GameGraph> make_graph(const Rules& rules) {
+    GameGraph graph(rules);
+    if(!discoverStates(rules, graph)) return {};
+
+    graph.keys.reserve(graph.size());
+    for(size_t w = 0; w < graph.words.size(); ++w) {
+        for(uint64_t word = graph.words[w]; word != 0; word &= word - 1) {
+            graph.keys.push_back(64*w + __builtin_ctzll(word));
+        }
+    }
+
+    std::array<Action, 3> actions { Action::Reload, Action::Shield, Action::Shoot };
+    graph.successors.resize(9*graph.size());
+    graph.costs.resize(9*graph.size());
+    for(size_t i = 0; i < graph.size(); ++i) {
+        GameState s = graph.state(i);
         for(Action a : actions) {
             for(Action b : actions) {
-                auto& edgeEntry = edgesTable[(int)a][(int)b];
-                auto& edgesCostEntry = edgesCostTable[(int)a][(int)b];
+                size_t edge = 9*i + 3*(int)a + (int)b;
                 GameState t = s;
                 t.resolve(a, b, rules);
                 if(t.gameOver()) {
                     const Player* winner = t.winner(&graph.a, &graph.b);
                     if(winner == &graph.a) {
-                        edgeEntry = AWIN;
-                        edgesCostEntry = -std::numeric_limits<double>::infinity();
+                        graph.successors[edge] = AWIN;
+                        graph.costs[edge] = -std::numeric_limits<float>::infinity();
                     } else if (winner == &graph.b) {
-                        edgeEntry = BWIN;
-                        edgesCostEntry = +std::numeric_limits<double>::infinity();
+                        graph.successors[edge] = BWIN;
+                        graph.costs[edge] = +std::numeric_limits<float>::infinity();
                     } else {
-                        edgeEntry = TIE;
-                        edgesCostEntry = 0.0;
+                        graph.successors[edge] = TIE;
+                        graph.costs[edge] = 0.0f;
                     }
                 } else {
-                    auto it = std::lower_bound(graph.states.begin(), graph.states.end(), t, StateComparator{});
-                    if(it == graph.states.end()) {
-                        fmt::print("Error in transition table\n");
-                        return {};
-                    }
-                    edgeEntry = std::distance(graph.states.begin(), it);
-                    edgesCostEntry = gameStateValue(rules, t) - gameStateValue(rules, s);
+                    graph.successors[edge] = (int32_t)graph.find(t.stateA(), t.stateB());
+                    graph.costs[edge] = (float)(gameStateValue(rules, t) - gameStateValue(rules, s));
                 }
             }
         }
     }
     GameState start;
-    auto entry = std::lower_bound(graph.states.begin(), graph.states.end(), start, StateComparator{});
-    if(entry == graph.states.end()) {
+    graph.entrypoint = graph.find(start.stateA(), start.stateB());
+    if(graph.entrypoint < 0) {
         // fmt::print("No entrypoint in graph\n");
         return {};
     }
-    graph.entrypoint = std::distance(graph.states.begin(), entry);
 
     return std::make_unique<GameGraph>(std::move(graph));
 }
@@ -167,14 +247,18 @@ static std::unique_ptr<GameGraph> make_graph(const Rules& rules) {
 
 static std::array<std::array<double, 3>, 3> formCostMatrix(const GameGraph& g, const std::vector<StrategyPoint>& payoff, size_t i)  {
     const double BIG_NUMBER = 500;
-    auto A = g.edgesCost[i];
-    for(auto& row : A) for(auto& e : row) {
-        if(e == -std::numeric_limits<double>::infinity()) e = -BIG_NUMBER;
-        if(e == +std::numeric_limits<double>::infinity()) e = +BIG_NUMBER;
+    std::array<std::array<double, 3>, 3> A;
+    for(int a = 0; a < 3; ++a) {
+        for(int b = 0; b < 3; ++b) {
+            double e = g.cost(i, a, b);
+            if(e == -std::numeric_limits<double>::infinity()) e = -BIG_NUMBER;
+            if(e == +std::numeric_limits<double>::infinity()) e = +BIG_NUMBER;
+            A[a][b] = e;
+        }
     }
     for(int a = 0; a < 3; ++a) {
         for(int b = 0; b < 3; ++b) {
-            ssize_t dst = g.edges[i][a][b];
+            int32_t dst = g.successor(i, a, b);
             if(dst >= 0) {
                 assert((size_t)dst < payoff.size());
                 A[a][b] += payoff[dst].value;
@@ -201,61 +285,937 @@ static std::array<std::array<double, 3>, 3> formCostMatrix(const GameGraph& g, c
     return d;
 }
 
-static std::vector<StrategyPoint> approximateMeanPayoff(const GameGraph& g) {
-    std::vector<StrategyPoint> v(g.states.size());
-    std::vector<StrategyPoint> vNext(g.states.size());
-    const int MAX_ITERATIONS = 300;
-    int iter = 0;
-    for(iter = 0; iter < MAX_ITERATIONS; ++iter) {
-        for(size_t i = 0; i < g.states.size(); ++i) {
-            auto A = formCostMatrix(g, v, i);
-            auto solution = BilinearMinMax::solve(A);
-            vNext[i] = solution;
+// Jacobi sweeps only read v and write vNext, so states are split in fixed blocks solved in parallel.
+// Block partial sums are reduced in block order, which keeps the result independent of the thread count.
+static constexpr size_t SWEEP_BLOCK_SIZE = 1024;
+
+// Statistics of one sweep, accumulated per state then per block
+struct SweepStats {
+    double l1Residual = 0.0;
+    double maxResidual = 0.0;
+    size_t strategyChanges = 0;
+    size_t solves = 0;
+
+    void add(double residual, bool strategyChanged) {
+        l1Residual += residual;
+        maxResidual = std::max(maxResidual, residual);
+        strategyChanges += strategyChanged;
+        ++solves;
+    }
+
+    SweepStats& operator+=(const SweepStats& other) {
+        l1Residual += other.l1Residual;
+        maxResidual = std::max(maxResidual, other.maxResidual);
+        strategyChanges += other.strategyChanges;
+        solves += other.solves;
+        return *this;
+    }
+};
+
+static bool strategyMoved(const Point& p, const Point& q, double tolerance) {
+    for(int i = 0; i < 3; ++i) {
+        if(std::abs(p.p[i] - q.p[i]) > tolerance) return true;
+    }
+    return false;
+}
+
+// Stopping rule of the Params, fed with the statistics of successive sweeps
+class StoppingRule {
+public:
+    explicit StoppingRule(const ShapleyPlayer::Params& params) : params_(params) { }
+
+    bool done(const SweepStats& sweep) {
+        stableSweeps_ = sweep.strategyChanges == 0 ? stableSweeps_ + 1 : 0;
+        if(params_.interrupt && params_.interrupt()) {
+            interrupted_ = true;
+            return true;
         }
-        size_t diffSize = 0;
-        size_t diffInf = 0;
-        size_t finiteMagn = 0;
-        for(size_t i = 0; i < v.size(); ++i) {
-            diffSize += (ssize_t)(v[i].value - vNext[i].value) != 0;
-            diffInf += (std::isinf(vNext[i].value) != std::isinf(v[i].value));
-            if(!std::isinf(vNext[i].value) && !std::isinf(v[i].value)) finiteMagn += std::abs(vNext[i].value - v[i].value);
+        switch(params_.stopping) {
+            case ShapleyPlayer::Stopping::Residual: return sweep.l1Residual <= params_.tolerance;
+            case ShapleyPlayer::Stopping::BellmanResidual: return sweep.maxResidual <= params_.tolerance;
+            case ShapleyPlayer::Stopping::PolicyStable: return sweep.l1Residual <= params_.tolerance || stableSweeps_ >= params_.stableSweeps;
         }
-        double d = distance(v, vNext);
-        // fmt::print("Iter #{:4}  DiffNz={} DiffInfNz={} diffMagn={} |v-v+|={}\n", iter, diffSize, diffInf, finiteMagn, d);
-        if(d <= 1.0e-3) break;
-        v.swap(vNext);
+        return true;
+    }
+
+    // True once Params::interrupt stopped the iteration
+    bool interrupted() const { return interrupted_; }
+
+private:
+    const ShapleyPlayer::Params& params_;
+    int stableSweeps_ = 0;
+    bool interrupted_ = false;
+};
+
+// Reports every sweep to Params::onIteration and applies the stopping rule
+class ConvergenceMonitor {
+public:
+    ConvergenceMonitor(const ShapleyPlayer::Params& params, const std::vector<SolverContext>& contexts) :
+        params_(params), contexts_(contexts), rule_(params), sweepStart_(std::chrono::steady_clock::now()) { }
+
+    // True when the iteration stops after this sweep
+    bool done(int iteration, const SweepStats& sweep) {
+        report(iteration, sweep);
+        return rule_.done(sweep);
+    }
+
+    bool interrupted() const { return rule_.interrupted(); }
+
+    void report(int iteration, const SweepStats& sweep) {
+        if(params_.onIteration) {
+            ShapleyPlayer::IterationReport report;
+            report.iteration = iteration;
+            report.l1Residual = sweep.l1Residual;
+            report.maxResidual = sweep.maxResidual;
+            report.strategyChanges = sweep.strategyChanges;
+            report.solves = sweep.solves;
+            report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sweepStart_).count();
+            for(const auto& context : contexts_) report.solverStats += context.stats;
+            params_.onIteration(report);
+        }
+        sweepStart_ = std::chrono::steady_clock::now();
     }
 
-    std::for_each(v.begin(), v.end(), [&](auto& e) { e.value /= iter; });
+private:
+    const ShapleyPlayer::Params& params_;
+    const std::vector<SolverContext>& contexts_;
+    StoppingRule rule_;
+    std::chrono::steady_clock::time_point sweepStart_;
+};
+
+// Raw values of the value iteration, before they are averaged over the number of sweeps.
+// Every mode returns the values and strategies of its last completed sweep, and the number
+// of sweeps completed as iterations.
+struct ValueIteration {
+    std::vector<StrategyPoint> values;
+    int iterations = 0;
+    bool interrupted = false;  // stopped by Params::interrupt rather than by the stopping rule
+};
+
+// At least one sweep, so that every state has a strategy and the values can be averaged
+static int sweepLimit(const ShapleyPlayer::Params& params) {
+    return std::max(1, params.maxIterations);
+}
 
+// Raw values the iteration starts from, all zero without a warm start
+static std::vector<StrategyPoint> startValues(size_t n, const std::vector<double>& initial) {
+    std::vector<StrategyPoint> v(n);
+    for(size_t i = 0; i < initial.size(); ++i) v[i].value = initial[i];
     return v;
 }
 
+static ValueIteration jacobiIteration(const GameGraph& g, const ShapleyPlayer::Params& params, const std::vector<double>& initial, const ShapleyPlayer::StageGameCallback* observer) {
+    std::vector<StrategyPoint> v = startValues(g.size(), initial);
+    std::vector<StrategyPoint> vNext(g.size());
+    std::vector<SupportHint> hints(g.size());
+    // The observer is not required to be thread-safe
+    ThreadPool pool(observer ? 1 : params.threads);
+    std::vector<SolverContext> contexts(pool.size());
+    ConvergenceMonitor monitor(params, contexts);
+    const size_t nbBlocks = (g.size() + SWEEP_BLOCK_SIZE - 1) / SWEEP_BLOCK_SIZE;
+    std::vector<SweepStats> blockStats(nbBlocks);
+    int sweeps = 0;
+    for(int iter = 0; iter < sweepLimit(params); ++iter) {
+        pool.parallelFor(nbBlocks, [&](size_t block, int worker) {
+            SweepStats& stats = blockStats[block];
+            stats = SweepStats{};
+            size_t end = std::min(g.size(), (block+1)*SWEEP_BLOCK_SIZE);
+            for(size_t i = block*SWEEP_BLOCK_SIZE; i < end; ++i) {
+                auto A = formCostMatrix(g, v, i);
+                if(observer) (*observer)(i, A);
+                vNext[i] = BilinearMinMax::solve(A, contexts[worker], &hints[i]);
+                stats.add(std::abs(v[i].value - vNext[i].value), strategyMoved(v[i].p, vNext[i].p, params.strategyTolerance));
+            }
+        });
+        SweepStats total;
+        for(const auto& stats : blockStats) total += stats;
+        v.swap(vNext);
+        sweeps = iter + 1;
+        if(monitor.done(iter, total)) break;
+    }
+
+    return ValueIteration { std::move(v), sweeps, monitor.interrupted() };
+}
+
+// Order in which successors come before their predecessors as much as cycles allow:
+// the post-order of a depth-first traversal. Lives never increase along an edge,
+// so states with fewer lives are finished first.
+static std::vector<size_t> successorsFirstOrder(const GameGraph& g) {
+    std::vector<size_t> order;
+    order.reserve(g.size());
+    std::vector<char> visited(g.size(), false);
+    std::vector<std::pair<size_t, int>> stack;
+    for(size_t root = 0; root < g.size(); ++root) {
+        if(visited[root]) continue;
+        visited[root] = true;
+        stack.emplace_back(root, 0);
+        while(!stack.empty()) {
+            auto& [node, edge] = stack.back();
+            if(edge == 9) {
+                order.push_back(node);
+                stack.pop_back();
+                continue;
+            }
+            int32_t dst = g.successor(node, edge/3, edge%3);
+            ++edge;
+            if(dst < 0 || visited[dst]) continue;
+            visited[dst] = true;
+            stack.emplace_back(dst, 0);
+        }
+    }
+    return order;
+}
+
+// In-place updates in successors-first order: every state already sees the values
+// computed earlier in the same sweep.
+static ValueIteration gaussSeidelIteration(const GameGraph& g, const ShapleyPlayer::Params& params, const std::vector<double>& initial, const ShapleyPlayer::StageGameCallback* observer) {
+    std::vector<StrategyPoint> v = startValues(g.size(), initial);
+    std::vector<SupportHint> hints(g.size());
+    std::vector<size_t> order = successorsFirstOrder(g);
+    std::vector<SolverContext> contexts(1);
+    ConvergenceMonitor monitor(params, contexts);
+    int sweeps = 0;
+    for(int iter = 0; iter < sweepLimit(params); ++iter) {
+        SweepStats stats;
+        for(size_t i : order) {
+            auto A = formCostMatrix(g, v, i);
+            if(observer) (*observer)(i, A);
+            auto solution = BilinearMinMax::solve(A, contexts[0], &hints[i]);
+            stats.add(std::abs(v[i].value - solution.value), strategyMoved(v[i].p, solution.p, params.strategyTolerance));
+            v[i] = solution;
+        }
+        sweeps = iter + 1;
+        if(monitor.done(iter, stats)) break;
+    }
+    return ValueIteration { std::move(v), sweeps, monitor.interrupted() };
+}
+
+// Gauss-Seidel where a state is only solved again once the values of its successors
+// moved by more than the threshold since its last solve. The changes are accumulated
+// per state, so that many small moves eventually trigger a solve too.
+static ValueIteration prioritizedIteration(const GameGraph& g, const ShapleyPlayer::Params& params, const std::vector<double>& initial, const ShapleyPlayer::StageGameCallback* observer) {
+    const size_t n = g.size();
+    if(n == 0) return {};
+    std::vector<size_t> predecessorsBegin(n+1, 0);
+    for(size_t i = 0; i < n; ++i) {
+        for(int edge = 0; edge < 9; ++edge) {
+            int32_t dst = g.successors[9*i + edge];
+            if(dst >= 0) ++predecessorsBegin[dst+1];
+        }
+    }
+    for(size_t i = 0; i < n; ++i) predecessorsBegin[i+1] += predecessorsBegin[i];
+    std::vector<size_t> predecessors(predecessorsBegin[n]);
+    std::vector<size_t> fill = predecessorsBegin;
+    for(size_t i = 0; i < n; ++i) {
+        for(int edge = 0; edge < 9; ++edge) {
+            int32_t dst = g.successors[9*i + edge];
+            if(dst >= 0) predecessors[fill[dst]++] = i;
+        }
+    }
+
+    std::vector<StrategyPoint> v = startValues(n, initial);
+    std::vector<SupportHint> hints(n);
+    // Accumulated change of the successors since the last solve of each state
+    std::vector<double> pending(n, 0.0);
+    std::vector<char> dirty(n, true);
+    std::vector<size_t> order = successorsFirstOrder(g);
+    std::vector<SolverContext> contexts(1);
+    ConvergenceMonitor monitor(params, contexts);
+    int sweeps = 0;
+    for(int iter = 0; iter < sweepLimit(params); ++iter) {
+        SweepStats stats;
+        for(size_t i : order) {
+            if(!dirty[i]) continue;
+            dirty[i] = false;
+            pending[i] = 0.0;
+            auto A = formCostMatrix(g, v, i);
+            if(observer) (*observer)(i, A);
+            auto solution = BilinearMinMax::solve(A, contexts[0], &hints[i]);
+            double delta = std::abs(v[i].value - solution.value);
+            stats.add(delta, strategyMoved(v[i].p, solution.p, params.strategyTolerance));
+            v[i] = solution;
+            for(size_t k = predecessorsBegin[i]; k < predecessorsBegin[i+1]; ++k) {
+                size_t p = predecessors[k];
+                pending[p] += delta;
+                if(pending[p] > params.priorityThreshold) dirty[p] = true;
+            }
+        }
+        // A sweep without any solve left every value as it was
+        if(stats.solves > 0) sweeps = iter + 1;
+        if(monitor.done(iter, stats) || stats.solves == 0) break;
+    }
+    return ValueIteration { std::move(v), sweeps, monitor.interrupted() };
+}
+
+// Outcome of the iteration of one (livesA, livesB) layer
+struct LayerResult {
+    SweepStats stats;  // last sweep, with the solves of every sweep
+    int sweeps = 0;
+    bool interrupted = false;
+};
+
+// Lives never increase along an edge, so the (livesA, livesB) layers form a DAG with cycles
+// only inside a layer. Layers are solved from the fewest total lives up by
+// solveLayer(states, worker), states being in successors-first order, with their successor
+// layers already final. Layers with the same total cannot reach each other and are solved
+// in parallel. One report is made per total: its solves count every sweep, its residuals and
+// strategy changes the last sweep of each layer. Returns the sweeps of the slowest layer.
+template<typename SolveLayer>
+static int solveLayers(const GameGraph& g, ThreadPool& pool, ConvergenceMonitor& monitor, bool* interrupted, SolveLayer&& solveLayer) {
+    const int maxLives = g.maxLives;
+    std::vector<std::vector<size_t>> layers((size_t)maxLives*maxLives);
+    for(size_t i : successorsFirstOrder(g)) {
+        GameState s = g.state(i);
+        layers[(size_t)(s.stateA().lives()-1)*maxLives + (s.stateB().lives()-1)].push_back(i);
+    }
+    std::vector<LayerResult> results(layers.size());
+    for(int totalLives = 2; totalLives <= 2*maxLives; ++totalLives) {
+        std::vector<size_t> diagonal;
+        for(int livesA = std::max(1, totalLives-maxLives); livesA <= std::min(maxLives, totalLives-1); ++livesA) {
+            size_t layer = (size_t)(livesA-1)*maxLives + (totalLives-livesA-1);
+            if(!layers[layer].empty()) diagonal.push_back(layer);
+        }
+        pool.parallelFor(diagonal.size(), [&](size_t k, int worker) {
+            results[diagonal[k]] = solveLayer(layers[diagonal[k]], worker);
+        });
+        SweepStats total;
+        for(size_t layer : diagonal) total += results[layer].stats;
+        monitor.report(totalLives-2, total);
+    }
+    int iterations = 0;
+    for(const LayerResult& result : results) {
+        iterations = std::max(iterations, result.sweeps);
+        *interrupted = *interrupted || result.interrupted;
+    }
+    return iterations;
+}
+
+// Each layer is iterated in place until the stopping rule holds
+static ValueIteration retrogradeIteration(const GameGraph& g, const ShapleyPlayer::Params& params, const std::vector<double>& initial, const ShapleyPlayer::StageGameCallback* observer) {
+    std::vector<StrategyPoint> v = startValues(g.size(), initial);
+    std::vector<SupportHint> hints(g.size());
+    // The observer is not required to be thread-safe
+    ThreadPool pool(observer ? 1 : params.threads);
+    std::vector<SolverContext> contexts(pool.size());
+    ConvergenceMonitor monitor(params, contexts);
+    bool interrupted = false;
+    int iterations = solveLayers(g, pool, monitor, &interrupted, [&](const std::vector<size_t>& states, int worker) {
+        StoppingRule rule(params);
+        LayerResult result;
+        size_t solves = 0;
+        for(int sweep = 0; sweep < sweepLimit(params); ++sweep) {
+            SweepStats stats;
+            for(size_t i : states) {
+                auto A = formCostMatrix(g, v, i);
+                if(observer) (*observer)(i, A);
+                auto solution = BilinearMinMax::solve(A, contexts[worker], &hints[i]);
+                stats.add(std::abs(v[i].value - solution.value), strategyMoved(v[i].p, solution.p, params.strategyTolerance));
+                v[i] = solution;
+            }
+            solves += stats.solves;
+            result.stats = stats;
+            result.sweeps = sweep + 1;
+            if(rule.done(stats)) break;
+        }
+        result.stats.solves = solves;
+        result.interrupted = rule.interrupted();
+        return result;
+    });
+    return ValueIteration { std::move(v), iterations, interrupted };
+}
+
+// Hoffman-Karp policy iteration, one layer at a time in the order of retrogradeIteration.
+// Improvement solves every stage game of the layer once with the current values and keeps the
+// strategies of A. Evaluation then solves the MDP left to B in the layer against those fixed
+// strategies, by in-place sweeps of v = max_b x^T A(v) e_b which only cost 9 products per state;
+// its successor layers are final, so it only iterates over the cycles of the layer. The stopping
+// rule applies to the improvements, of which there are at most maxIterations per layer; an
+// evaluation stops at a tenth of the tolerance or after maxIterations sweeps. The values are
+// averaged over the sweeps of both kinds of the slowest layer, as each applied one more step to them.
+static ValueIteration policyIteration(const GameGraph& g, const ShapleyPlayer::Params& params, const std::vector<double>& initial, const ShapleyPlayer::StageGameCallback* observer) {
+    std::vector<StrategyPoint> v = startValues(g.size(), initial);
+    std::vector<SupportHint> hints(g.size());
+    ThreadPool pool(observer ? 1 : params.threads);
+    std::vector<SolverContext> contexts(pool.size());
+    ConvergenceMonitor monitor(params, contexts);
+    const int limit = sweepLimit(params);
+    bool interrupted = false;
+    int iterations = solveLayers(g, pool, monitor, &interrupted, [&](const std::vector<size_t>& states, int worker) {
+        StoppingRule rule(params);
+        LayerResult result;
+        size_t solves = 0;
+        std::vector<StrategyPoint> improved(states.size());
+        for(int iter = 0; iter < limit; ++iter) {
+            // Improvement, against the values of the previous strategies
+            SweepStats stats;
+            for(size_t k = 0; k < states.size(); ++k) {
+                size_t i = states[k];
+                auto A = formCostMatrix(g, v, i);
+                if(observer) (*observer)(i, A);
+                improved[k] = BilinearMinMax::solve(A, contexts[worker], &hints[i]);
+                stats.add(std::abs(v[i].value - improved[k].value), strategyMoved(v[i].p, improved[k].p, params.strategyTolerance));
+            }
+            for(size_t k = 0; k < states.size(); ++k) v[states[k]] = improved[k];
+            solves += stats.solves;
+            result.stats = stats;
+            ++result.sweeps;
+            if(rule.done(stats)) break;
+
+            // Evaluation, best responses of B starting from the improved values
+            for(int sweep = 0; sweep < limit; ++sweep) {
+                double d = 0;
+                for(size_t i : states) {
+                    auto A = formCostMatrix(g, v, i);
+                    const double* x = v[i].p.p;
+                    double value = -std::numeric_limits<double>::infinity();
+                    for(int b = 0; b < 3; ++b) {
+                        value = std::max(value, x[0]*A[0][b] + x[1]*A[1][b] + x[2]*A[2][b]);
+                    }
+                    d += std::abs(v[i].value - value);
+                    v[i].value = value;
+                }
+                ++result.sweeps;
+                if(d <= 0.1*params.tolerance) break;
+            }
+        }
+        result.stats.solves = solves;
+        result.interrupted = rule.interrupted();
+        return result;
+    });
+    return ValueIteration { std::move(v), iterations, interrupted };
+}
+
+// Values are averaged over the number of sweeps
+static ValueIteration approximateMeanPayoff(const GameGraph& g, const ShapleyPlayer::Params& params, const std::vector<double>& initial, const ShapleyPlayer::StageGameCallback* observer = nullptr) {
+    ValueIteration result;
+    switch(params.iteration) {
+        case ShapleyPlayer::Iteration::Jacobi: result = jacobiIteration(g, params, initial, observer); break;
+        case ShapleyPlayer::Iteration::GaussSeidel: result = gaussSeidelIteration(g, params, initial, observer); break;
+        case ShapleyPlayer::Iteration::Prioritized: result = prioritizedIteration(g, params, initial, observer); break;
+        case ShapleyPlayer::Iteration::Policy: result = policyIteration(g, params, initial, observer); break;
+        case ShapleyPlayer::Iteration::Retrograde: result = retrogradeIteration(g, params, initial, observer); break;
+    }
+    assert(result.values.empty() || result.iterations > 0);
+    std::for_each(result.values.begin(), result.values.end(), [&](auto& e) { e.value /= result.iterations; });
+    return result;
+}
+
+// Lean mode keeps only the StateSet: the edges of a state are generated again from the
+// Rules every time its stage game is formed, and values are stored as float.
+// While iterating, a reachable state takes 4 bytes of value, 4 more for the Jacobi
+// double buffer, 4 of support hint and 1 of strategy support; the final policy takes
+// 16 bytes per state. On top of that come 1.5 bits per packed key for the StateSet and,
+// during discovery, up to 8 bytes per state of depth-first stack.
+struct LeanGraph : StateSet {
+    explicit LeanGraph(const Rules& rules) : rules(rules), a(rules), b(rules) { }
+
+    Rules rules;
+    DummyPlayer a;
+    DummyPlayer b;
+};
+
+// Calls f(node, key) for the states of words [wordBegin, wordEnd), in node order
+template<typename F>
+static void forEachNode(const StateSet& set, size_t wordBegin, size_t wordEnd, F&& f) {
+    for(size_t w = wordBegin; w < wordEnd; ++w) {
+        size_t node = set.ranks[w];
+        for(uint64_t word = set.words[w]; word != 0; word &= word - 1) {
+            f(node++, 64*w + __builtin_ctzll(word));
+        }
+    }
+}
+
+// Same matrix as formCostMatrix, with the edges generated on the fly
+static std::array<std::array<double, 3>, 3> formLeanCostMatrix(const LeanGraph& g, const std::vector<float>& payoff, size_t key) {
+    const double BIG_NUMBER = 500;
+    std::array<Action, 3> actions { Action::Reload, Action::Shield, Action::Shoot };
+    GameState s = g.unpackKey(key);
+    std::array<std::array<double, 3>, 3> A;
+    for(Action a : actions) {
+        for(Action b : actions) {
+            double& e = A[(int)a][(int)b];
+            GameState t = s;
+            t.resolve(a, b, g.rules);
+            if(t.gameOver()) {
+                const Player* winner = t.winner(&g.a, &g.b);
+                if(winner == &g.a) {
+                    e = -2*BIG_NUMBER;
+                } else if (winner == &g.b) {
+                    e = +2*BIG_NUMBER;
+                } else {
+                    e = 0.0;
+                }
+            } else {
+                ssize_t dst = g.find(t.stateA(), t.stateB());
+                assert(dst >= 0);
+                e = (gameStateValue(g.rules, t) - gameStateValue(g.rules, s)) + payoff[dst];
+            }
+        }
+    }
+    return A;
+}
+
+// Actions played with probability above the tolerance, as a bit mask
+static uint8_t strategySupport(const Point& p, double tolerance) {
+    return (p.p[0] > tolerance) | (p.p[1] > tolerance) << 1 | (p.p[2] > tolerance) << 2;
+}
+
+struct LeanIteration {
+    std::vector<float> values;
+    int iterations = 0;
+    bool interrupted = false;
+};
+
+static constexpr size_t LEAN_BLOCK_WORDS = SWEEP_BLOCK_SIZE / 64;
+
+// Jacobi sweeps in parallel, any other mode is an in-place sweep in node order,
+// since the lean graph has no predecessor lists to order or prioritize the states.
+// Strategies are not stored, so a strategy change is a change of its support.
+static LeanIteration leanIteration(const LeanGraph& g, const ShapleyPlayer::Params& params, const std::vector<double>& initial) {
+    const bool jacobi = params.iteration == ShapleyPlayer::Iteration::Jacobi;
+    std::vector<float> v(g.size(), 0.0f);
+    std::copy(initial.begin(), initial.end(), v.begin());
+    std::vector<float> vNext(jacobi ? g.size() : 0, 0.0f);
+    std::vector<SupportHint> hints(g.size());
+    std::vector<uint8_t> supports(g.size(), 0);
+    ThreadPool pool(jacobi ? params.threads : 1);
+    std::vector<SolverContext> contexts(pool.size());
+    ConvergenceMonitor monitor(params, contexts);
+    const size_t nbBlocks = (g.words.size() + LEAN_BLOCK_WORDS - 1) / LEAN_BLOCK_WORDS;
+    std::vector<SweepStats> blockStats(nbBlocks);
+    int sweeps = 0;
+    for(int iter = 0; iter < sweepLimit(params); ++iter) {
+        std::vector<float>& out = jacobi ? vNext : v;
+        pool.parallelFor(nbBlocks, [&](size_t block, int worker) {
+            SweepStats& stats = blockStats[block];
+            stats = SweepStats{};
+            size_t end = std::min(g.words.size(), (block+1)*LEAN_BLOCK_WORDS);
+            forEachNode(g, block*LEAN_BLOCK_WORDS, end, [&](size_t node, size_t key) {
+                auto A = formLeanCostMatrix(g, v, key);
+                auto solution = BilinearMinMax::solve(A, contexts[worker], &hints[node]);
+                float value = (float)solution.value;
+                uint8_t support = strategySupport(solution.p, params.strategyTolerance);
+                // Float values can end in a cycle of one ulp, which counts as converged
+                double residual = std::abs((double)v[node] - value);
+                if(residual <= 2*std::numeric_limits<float>::epsilon()*std::max(1.0f, std::abs(value))) residual = 0.0;
+                stats.add(residual, support != supports[node]);
+                supports[node] = support;
+                out[node] = value;
+            });
+        });
+        SweepStats total;
+        for(const auto& stats : blockStats) total += stats;
+        if(jacobi) v.swap(vNext);
+        sweeps = iter + 1;
+        if(monitor.done(iter, total)) break;
+    }
+    return LeanIteration { std::move(v), sweeps, monitor.interrupted() };
+}
+
+// Layout of the policy cache files, in native byte order: the header, the words and ranks
+// of the StateSet, the mean payoff of every node, then the running sums of its strategy.
+// Sections are 8-byte aligned. Lean policies store values and thresholds as float.
+// Solver parameters that change the policy, with the unused ones zeroed
+struct SolveKey {
+    int32_t iteration;
+    uint32_t flags;
+    int32_t stopping;
+    int32_t maxIterations;
+    int32_t stableSweeps;
+    int32_t reserved;
+    double priorityThreshold;
+    double tolerance;
+    double strategyTolerance;
+};
+
+struct PolicyFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    // What the policy was solved for
+    int32_t startLives;
+    int32_t maxBullets;
+    int32_t maxShields;
+    // Number of sweeps the values were averaged over
+    int32_t iterations;
+    SolveKey key;
+    // Bounds of the StateIndexer
+    int32_t boundLives;
+    int32_t boundBullets;
+    int32_t boundShields;
+    int32_t reserved;
+    uint64_t nbNodes;
+    uint64_t wordsOffset;
+    uint64_t ranksOffset;
+    uint64_t valuesOffset;
+    uint64_t thresholdsOffset;
+    uint64_t fileSize;
+};
+
+static constexpr char POLICY_MAGIC[8] = { 'J', 'B', 'S', 'H', 'A', 'P', 'L', 'Y' };
+static constexpr uint32_t POLICY_VERSION = 5;
+static constexpr uint32_t POLICY_BYTE_ORDER = 0x01020304;
+static constexpr uint32_t POLICY_LEAN = 1;
+
+static uint64_t alignedOffset(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+static SolveKey solveKey(const ShapleyPlayer::Params& params) {
+    SolveKey key {};
+    key.iteration = (int32_t)params.iteration;
+    key.flags = params.lean ? POLICY_LEAN : 0;
+    key.stopping = (int32_t)params.stopping;
+    key.maxIterations = params.maxIterations;
+    key.tolerance = params.tolerance;
+    if(params.stopping == ShapleyPlayer::Stopping::PolicyStable) {
+        key.stableSweeps = params.stableSweeps;
+        key.strategyTolerance = params.strategyTolerance;
+    }
+    if(params.iteration == ShapleyPlayer::Iteration::Prioritized && !params.lean) {
+        key.priorityThreshold = params.priorityThreshold;
+    }
+    return key;
+}
+
+static std::string policyFileName(const Rules& rules, const ShapleyPlayer::Params& params) {
+    // FNV-1a of the key, the header holds the key itself to tell collisions apart
+    SolveKey key = solveKey(params);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&key);
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < sizeof(key); ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return fmt::format("shapley-v{}-{}-{}-{}-{:016x}.bin", POLICY_VERSION,
+        rules.startLives, rules.maxBullets, rules.maxShields, hash);
+}
+
+// Solved policy, either owning its buffer or mapping a cache file read-only
+// so that every process using the same file shares one copy.
+struct ShapleyPolicy : StateIndexer {
+    ShapleyPolicy() = default;
+    ShapleyPolicy(const ShapleyPolicy&) = delete;
+    ShapleyPolicy& operator=(const ShapleyPolicy&) = delete;
+    ~ShapleyPolicy() {
+        if(mapping) munmap(mapping, mappingSize);
+    }
+
+    const PolicyFileHeader* header = nullptr;
+    const uint64_t* words = nullptr;
+    const uint32_t* ranks = nullptr;
+    const char* values = nullptr;
+    const char* thresholds = nullptr;
+
+    std::vector<uint64_t> buffer;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+    size_t size() const { return header->nbNodes; }
+    bool lean() const { return header->key.flags & POLICY_LEAN; }
+
+    ssize_t find(const PlayerState& sa, const PlayerState& sb) const {
+        ssize_t key = packedKey(sa, sb);
+        if(key < 0) return -1;
+        return StateSet::nodeOf(words, ranks, key);
+    }
+
+    // Value before the averaging over the sweeps
+    double rawValue(size_t node) const {
+        double value = lean() ? reinterpret_cast<const float*>(values)[node] : reinterpret_cast<const double*>(values)[node];
+        return value * header->iterations;
+    }
+
+    Rules solvedRules() const {
+        Rules rules;
+        rules.startLives = header->startLives;
+        rules.maxBullets = header->maxBullets;
+        rules.maxShields = header->maxShields;
+        return rules;
+    }
+
+    std::array<double, 3> thresholdsOf(size_t node) const {
+        if(lean()) {
+            const float* t = reinterpret_cast<const float*>(thresholds) + 3*node;
+            return std::array<double, 3>{{ t[0], t[1], t[2] }};
+        }
+        return reinterpret_cast<const std::array<double, 3>*>(thresholds)[node];
+    }
+
+    // Owned policy for the states of the set, filled with setNode
+    static std::unique_ptr<ShapleyPolicy> allocate(const StateSet& set, const Rules& rules, const ShapleyPlayer::Params& params, int iterations);
+    static std::unique_ptr<ShapleyPolicy> fromSolution(const GameGraph& g, const ValueIteration& solution, const Rules& rules, const ShapleyPlayer::Params& params);
+    static std::unique_ptr<ShapleyPolicy> load(const std::string& path, const Rules& rules, const ShapleyPlayer::Params& params);
+    void setNode(size_t node, double value, const Point& strategy);
+    bool save(const std::string& path) const;
+
+private:
+    bool attach(const void* data, size_t size, const Rules& rules, const ShapleyPlayer::Params& params);
+};
+
+std::unique_ptr<ShapleyPolicy> ShapleyPolicy::allocate(const StateSet& set, const Rules& rules, const ShapleyPlayer::Params& params, int iterations) {
+    const size_t valueSize = params.lean ? sizeof(float) : sizeof(double);
+    PolicyFileHeader header {};
+    std::memcpy(header.magic, POLICY_MAGIC, sizeof(POLICY_MAGIC));
+    header.version = POLICY_VERSION;
+    header.byteOrder = POLICY_BYTE_ORDER;
+    header.startLives = rules.startLives;
+    header.maxBullets = rules.maxBullets;
+    header.maxShields = rules.maxShields;
+    header.iterations = iterations;
+    header.key = solveKey(params);
+    header.boundLives = set.maxLives;
+    header.boundBullets = set.maxBullets;
+    header.boundShields = set.maxShields;
+    header.nbNodes = set.size();
+    header.wordsOffset = alignedOffset(sizeof(PolicyFileHeader));
+    header.ranksOffset = alignedOffset(header.wordsOffset + set.words.size()*sizeof(uint64_t));
+    header.valuesOffset = alignedOffset(header.ranksOffset + set.ranks.size()*sizeof(uint32_t));
+    header.thresholdsOffset = alignedOffset(header.valuesOffset + set.size()*valueSize);
+    header.fileSize = header.thresholdsOffset + 3*set.size()*valueSize;
+
+    auto policy = std::make_unique<ShapleyPolicy>();
+    policy->buffer.resize((header.fileSize + 7) / 8, 0);
+    char* data = reinterpret_cast<char*>(policy->buffer.data());
+    std::memcpy(data, &header, sizeof(header));
+    std::memcpy(data + header.wordsOffset, set.words.data(), set.words.size()*sizeof(uint64_t));
+    std::memcpy(data + header.ranksOffset, set.ranks.data(), set.ranks.size()*sizeof(uint32_t));
+    if(!policy->attach(data, header.fileSize, rules, params)) return {};
+    return policy;
+}
+
+void ShapleyPolicy::setNode(size_t node, double value, const Point& strategy) {
+    assert(!buffer.empty() && node < size());
+    const double* p = strategy.p;
+    std::array<double, 3> cumulative {{ p[0], p[0]+p[1], p[0]+p[1]+p[2] }};
+    char* data = reinterpret_cast<char*>(buffer.data());
+    if(lean()) {
+        reinterpret_cast<float*>(data + header->valuesOffset)[node] = (float)value;
+        float* t = reinterpret_cast<float*>(data + header->thresholdsOffset) + 3*node;
+        for(int i = 0; i < 3; ++i) t[i] = (float)cumulative[i];
+    } else {
+        reinterpret_cast<double*>(data + header->valuesOffset)[node] = value;
+        reinterpret_cast<std::array<double, 3>*>(data + header->thresholdsOffset)[node] = cumulative;
+    }
+}
+
+std::unique_ptr<ShapleyPolicy> ShapleyPolicy::fromSolution(const GameGraph& g, const ValueIteration& solution, const Rules& rules, const ShapleyPlayer::Params& params) {
+    auto policy = allocate(g, rules, params, solution.iterations);
+    if(!policy) return {};
+    for(size_t i = 0; i < g.size(); ++i) {
+        policy->setNode(i, solution.values[i].value, solution.values[i].p);
+    }
+    return policy;
+}
+
+bool ShapleyPolicy::attach(const void* data, size_t size, const Rules& rules, const ShapleyPlayer::Params& params) {
+    if(size < sizeof(PolicyFileHeader)) return false;
+    const char* bytes = static_cast<const char*>(data);
+    const auto* h = reinterpret_cast<const PolicyFileHeader*>(bytes);
+    if(std::memcmp(h->magic, POLICY_MAGIC, sizeof(POLICY_MAGIC)) != 0) return false;
+    if(h->version != POLICY_VERSION || h->byteOrder != POLICY_BYTE_ORDER) return false;
+    if(h->startLives != rules.startLives || h->maxBullets != rules.maxBullets || h->maxShields != rules.maxShields) return false;
+    SolveKey key = solveKey(params);
+    if(std::memcmp(&h->key, &key, sizeof(key)) != 0) return false;
+    if(h->boundLives < 1 || h->boundBullets < 0 || h->boundShields < 0 || h->iterations < 0) return false;
+    maxLives = h->boundLives;
+    maxBullets = h->boundBullets;
+    maxShields = h->boundShields;
+    const size_t nbWords = (nbKeys() + 63) / 64;
+    const size_t valueSize = (h->key.flags & POLICY_LEAN) ? sizeof(float) : sizeof(double);
+    if(h->fileSize != size || nbWords == 0) return false;
+    if(h->wordsOffset % 8 != 0 || h->ranksOffset % 8 != 0 || h->valuesOffset % 8 != 0 || h->thresholdsOffset % 8 != 0) return false;
+    if(h->wordsOffset < sizeof(PolicyFileHeader)) return false;
+    if(h->ranksOffset < h->wordsOffset + nbWords*sizeof(uint64_t)) return false;
+    if(h->valuesOffset < h->ranksOffset + nbWords*sizeof(uint32_t)) return false;
+    if(h->thresholdsOffset < h->valuesOffset + h->nbNodes*valueSize) return false;
+    if(size < h->thresholdsOffset + 3*h->nbNodes*valueSize) return false;
+    header = h;
+    words = reinterpret_cast<const uint64_t*>(bytes + h->wordsOffset);
+    ranks = reinterpret_cast<const uint32_t*>(bytes + h->ranksOffset);
+    values = bytes + h->valuesOffset;
+    thresholds = bytes + h->thresholdsOffset;
+    // Every rank must count the bits of the words before it, so that node ids stay below nbNodes
+    uint64_t rank = 0;
+    for(size_t w = 0; w < nbWords; ++w) {
+        if(ranks[w] != rank) return false;
+        rank += (uint64_t)__builtin_popcountll(words[w]);
+    }
+    return rank == h->nbNodes;
+}
+
+std::unique_ptr<ShapleyPolicy> ShapleyPolicy::load(const std::string& path, const Rules& rules, const ShapleyPlayer::Params& params) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) return {};
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return {};
+    }
+    size_t size = (size_t)st.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED) return {};
+    auto policy = std::make_unique<ShapleyPolicy>();
+    policy->mapping = mapping;
+    policy->mappingSize = size;
+    if(!policy->attach(mapping, size, rules, params)) return {};
+    return policy;
+}
+
+// Written to a temporary file first, so that concurrent readers only ever see complete files
+bool ShapleyPolicy::save(const std::string& path) const {
+    std::string tmpPath = fmt::format("{}.tmp{}", path, getpid());
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!out) return false;
+        out.write(reinterpret_cast<const char*>(header), (std::streamsize)header->fileSize);
+        if(!out) {
+            out.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Raw values of a previous solve mapped onto the states of the set. States outside of the
+// previous bounds take the value of the nearest one inside, each field being clamped.
+// Values are shifted by the change of the potential gameStateValue, from which the stage
+// costs are computed, so that only the expected outcome carries over.
+static std::vector<double> warmStartValues(const StateSet& set, const Rules& rules, const ShapleyPolicy& previous) {
+    Rules previousRules = previous.solvedRules();
+    auto clamped = [&](const PlayerState& p) {
+        return PlayerState::from(
+            std::clamp(p.lives(), 1, previous.maxLives),
+            std::clamp(p.bullets(), 0, previous.maxBullets),
+            std::clamp(p.remainingShields(), 0, previous.maxShields));
+    };
+    std::vector<double> initial(set.size(), 0.0);
+    forEachNode(set, 0, set.words.size(), [&](size_t node, size_t key) {
+        GameState s = set.unpackKey(key);
+        PlayerState sa = clamped(s.stateA());
+        PlayerState sb = clamped(s.stateB());
+        ssize_t previousNode = previous.find(sa, sb);
+        if(previousNode < 0) return;
+        initial[node] = previous.rawValue(previousNode) + gameStateValue(previousRules, sa, sb) - gameStateValue(rules, s);
+    });
+    return initial;
+}
+
+// Sets *interrupted when Params::interrupt stopped the iteration
+static std::unique_ptr<ShapleyPolicy> solvePolicy(const Rules& rules, const ShapleyPlayer::Params& params, const ShapleyPolicy* previous, bool* interrupted) {
+    auto graph = make_graph(rules);
+    if(!graph) return {};
+    std::vector<double> initial;
+    if(previous) initial = warmStartValues(*graph, rules, *previous);
+    ValueIteration result = approximateMeanPayoff(*graph, params, initial);
+    *interrupted = result.interrupted;
+    return ShapleyPolicy::fromSolution(*graph, result, rules, params);
+}
+
+static std::unique_ptr<ShapleyPolicy> solveLeanPolicy(const Rules& rules, const ShapleyPlayer::Params& params, const ShapleyPolicy* previous, bool* interrupted) {
+    LeanGraph graph(rules);
+    if(!discoverStates(rules, graph)) return {};
+    GameState start;
+    if(graph.find(start.stateA(), start.stateB()) < 0) return {};
+    LeanIteration result = leanIteration(graph, params, previous ? warmStartValues(graph, rules, *previous) : std::vector<double>{});
+    *interrupted = result.interrupted;
+    auto policy = ShapleyPolicy::allocate(graph, rules, params, result.iterations);
+    if(!policy) return {};
+    // The strategies come from one more solve of every stage game, with the final values
+    SolverContext context;
+    forEachNode(graph, 0, graph.words.size(), [&](size_t node, size_t key) {
+        auto solution = BilinearMinMax::solve(formLeanCostMatrix(graph, result.values, key), context);
+        policy->setNode(node, result.values[node] / result.iterations, solution.p);
+    });
+    return policy;
+}
+
+ShapleyPlayer::Params ShapleyPlayer::defaultParams() {
+    Params params;
+    if(const char* cacheDirectory = std::getenv("JAMESBOND_SHAPLEY_CACHE")) params.cacheDirectory = cacheDirectory;
+    return params;
+}
+
 std::unique_ptr<ShapleyPlayer> ShapleyPlayer::tryCreate(const Rules& rules, int seed) {
-    if(rules.startLives > 10) return {};
-    if(rules.maxBullets > 10) return {};
-    if(rules.maxShields > 10) return {};
-    return std::unique_ptr<ShapleyPlayer>(new ShapleyPlayer(rules, seed));
+    return tryCreate(rules, seed, defaultParams());
+}
+
+std::unique_ptr<ShapleyPlayer> ShapleyPlayer::tryCreate(const Rules& rules, int seed, const Params& params) {
+    const int maxDimension = params.lean ? LEAN_MAX_DIMENSION : MAX_DIMENSION;
+    if(rules.startLives > maxDimension) return {};
+    if(rules.maxBullets > maxDimension) return {};
+    if(rules.maxShields > maxDimension) return {};
+    return std::unique_ptr<ShapleyPlayer>(new ShapleyPlayer(rules, seed, params));
+}
+
+bool ShapleyPlayer::forEachStageGame(const Rules& rules, const StageGameCallback& callback) {
+    auto graph = make_graph(rules);
+    if(!graph) return false;
+    approximateMeanPayoff(*graph, Params{}, {}, &callback);
+    return true;
 }
 
-ShapleyPlayer::ShapleyPlayer(const Rules& rules, int seed) : Player(rules), rand_(seed) {
-    gameGraph_ = make_graph(rules_);
-    if(!gameGraph_) return;
-    meanPayoff_ = approximateMeanPayoff(*gameGraph_);
+bool ShapleyPlayer::profileSolve(const Rules& rules, const Params& params, SolveProfile* profile) {
+    auto begin = std::chrono::steady_clock::now();
+    auto graph = make_graph(rules);
+    if(!graph) return false;
+    auto graphEnd = std::chrono::steady_clock::now();
+    Params counting = params;
+    size_t solves = 0;
+    counting.onIteration = [&](const IterationReport& report) { solves += report.solves; };
+    ValueIteration result = approximateMeanPayoff(*graph, counting, {});
+    auto end = std::chrono::steady_clock::now();
+    profile->states = graph->size();
+    profile->graphSeconds = std::chrono::duration<double>(graphEnd - begin).count();
+    profile->iterationSeconds = std::chrono::duration<double>(end - graphEnd).count();
+    profile->iterations = result.iterations;
+    profile->solves = solves;
+    return true;
 }
 
+ShapleyPlayer::ShapleyPlayer(const Rules& rules, int seed, const Params& params) : Player(rules), rand_(seed) {
+    std::string cachePath;
+    if(!params.cacheDirectory.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(params.cacheDirectory, ec);
+        cachePath = (std::filesystem::path(params.cacheDirectory) / policyFileName(rules_, params)).string();
+        policy_ = ShapleyPolicy::load(cachePath, rules_, params);
+        Counters::add(policy_ ? Counter::PolicyFileHits : Counter::PolicyFileMisses);
+        if(policy_) return;
+    }
+    const ShapleyPolicy* previous = params.warmStart ? params.warmStart->policy_.get() : nullptr;
+    bool interrupted = false;
+    policy_ = params.lean ? solveLeanPolicy(rules_, params, previous, &interrupted) : solvePolicy(rules_, params, previous, &interrupted);
+    // A warm-started policy depends on the player it started from, which the cache key leaves out
+    if(policy_ && !cachePath.empty() && !interrupted && !params.warmStart) policy_->save(cachePath);
+}
 ShapleyPlayer::~ShapleyPlayer() = default;
 
 Action ShapleyPlayer::nextAction(const PlayerState& stateA, const PlayerState& stateB) {
-    std::pair<PlayerState, PlayerState> p { stateA, stateB };
-    auto it = std::lower_bound(gameGraph_->states.begin(), gameGraph_->states.end(), p, StateComparator2{});
-    size_t pos = std::distance(gameGraph_->states.begin(), it);
-    const auto& payoff = meanPayoff_[pos];
-    Action preferredAction = actionWithBias(rand_, payoff.p.p[0], payoff.p.p[1], payoff.p.p[2]);
+    ssize_t node = policy_ ? policy_->find(stateA, stateB) : -1;
+    Counters::add(node >= 0 ? Counter::PolicyHits : Counter::PolicyMisses);
+    if(node < 0) return stateA.randomAllowedAction(&rand_, rules_);
+    Action preferredAction = (Action)rand_.pickWithCumulativeBias(policy_->thresholdsOf(node));
     if(stateA.isLegalAction(preferredAction, rules_)) return preferredAction;
     return stateA.randomAllowedAction(&rand_, rules_);
 }
 
+ShapleyPlayer::Tables ShapleyPlayer::tables() const {
+    Tables tables;
+    if(!policy_) return tables;
+    tables.nodes = policy_->size();
+    tables.singlePrecision = policy_->lean();
+    tables.values = policy_->values;
+    tables.thresholds = policy_->thresholds;
+    tables.stateBitmap = policy_->words;
+    tables.stateBitmapWords = (policy_->nbKeys() + 63) / 64;
+    tables.maxLives = policy_->maxLives;
+    tables.maxBullets = policy_->maxBullets;
+    tables.maxShields = policy_->maxShields;
+    return tables;
+}
+
 void ShapleyPlayer::learnFromGame(const GameRecording&) {
 
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "threadpool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int nbThreads) {
+    if(nbThreads <= 0) nbThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    for(int worker = 1; worker < nbThreads; ++worker) {
+        workers_.emplace_back([this, worker]() { work(worker); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeUp_.notify_all();
+    for(auto& t : workers_) t.join();
+}
+
+void ThreadPool::runTasks(int worker) {
+    for(size_t task = nextTask_++; task < nbTasks_; task = nextTask_++) {
+        (*job_)(task, worker);
+    }
+}
+
+void ThreadPool::work(int worker) {
+    size_t seenGeneration = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeUp_.wait(lock, [&]() { return stopping_ || generation_ != seenGeneration; });
+            if(stopping_) return;
+            seenGeneration = generation_;
+        }
+        runTasks(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busyWorkers_;
+        }
+        done_.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(size_t nbTasks, const std::function<void(size_t task, int worker)>& f) {
+    if(workers_.empty() || nbTasks <= 1) {
+        for(size_t task = 0; task < nbTasks; ++task) f(task, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &f;
+        nbTasks_ = nbTasks;
+        nextTask_ = 0;
+        busyWorkers_ = (int)workers_.size();
+        ++generation_;
+    }
+    wakeUp_.notify_all();
+    runTasks(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]() { return busyWorkers_ == 0; });
+    job_ = nullptr;
+}
@@ -0,0 +1,374 @@
+#include "gamearena.h"
+#include "tourney.h"
+#include "players/biasedrandom.h"
+#include "players/bilinear.h"
+#include "players/qlearner.h"
+#include "players/random.h"
+#include "players/shapley.h"
+#include "fmt/core.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// End-to-end throughput of standard scenarios, under fixed seeds.
+//
+//   jamesbond-throughput [--repetitions R] [--scale X] [--rules LIVES BULLETS SHIELDS]
+//                        [--target-confidence C] [--scenarios NAME,NAME,...] [--json FILE]
+//                        [--save-baseline FILE] [--baseline FILE] [--tolerance T] [--rss-tolerance T]
+//
+// Scenarios:
+//   random-vs-random      games between two RandomPlayers, timed one by one for the latency percentiles
+//   qlearner-training     a QLearner trained against a RandomPlayer until confidence() reaches the target
+//   shapley-construction  ShapleyPlayer::tryCreate without cache
+//   tourney-testD         Tourney::run on the roster of testD in main.cpp, the players built beforehand
+//
+// Every repetition of a scenario runs in a child process of its own, so that its peak RSS is its own.
+// The repetition with the median time is reported, with the largest peak RSS of all of them.
+// --scale multiplies the number of games, to trade precision for time.
+//
+// A baseline file holds "scenario metric value" lines. Against a baseline, a metric regresses when it
+// is worse by more than the tolerance (relative, --rss-tolerance for peak_rss_kb), and the exit code is 1.
+
+struct Options {
+    int repetitions = 3;
+    double scale = 1.0;
+    double targetConfidence = 1.5;
+    Rules rules;
+    std::string jsonFile;
+    std::string baselineFile;
+    std::string saveBaselineFile;
+    double tolerance = 0.10;
+    double rssTolerance = 0.20;
+    std::vector<std::string> scenarios;
+};
+
+// Outcome of one repetition, sent as is by the child through a pipe
+struct Measurement {
+    bool ok = false;
+    double seconds = 0.0;
+    double games = 0.0;
+    double p50Micros = 0.0;  // per game, 0 when games are not timed one by one
+    double p99Micros = 0.0;
+    double gamesToTarget = 0.0;
+};
+
+struct Metric {
+    std::string name;
+    double value = 0.0;
+    bool higherIsBetter = false;
+    bool memory = false;
+};
+
+struct ScenarioResult {
+    std::string name;
+    bool ok = false;
+    std::vector<Metric> metrics;
+};
+
+static int scaled(const Options& options, int games) {
+    return std::max(1, (int)std::lround(options.scale * games));
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static double percentile(std::vector<double> samples, double p) {
+    if(samples.empty()) return 0.0;
+    size_t k = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+static std::unique_ptr<QLearner> trainedQLearner(const Rules& rules, int seed) {
+    RandomPlayer r(rules, seed);
+    auto q = QLearner::tryCreate(rules, 421*seed+1);
+    if(!q) return q;
+    Tourney::play2v2(100000, &r, q.get(), Tourney::Params { false, true });
+    return q;
+}
+
+static Measurement randomVsRandom(const Options& options) {
+    Measurement m;
+    RandomPlayer a(options.rules, 0);
+    RandomPlayer b(options.rules, 1);
+    const int games = scaled(options, 200000);
+    std::vector<double> latencies;
+    latencies.reserve(games);
+    auto begin = std::chrono::steady_clock::now();
+    for(int game = 0; game < games; ++game) {
+        auto gameBegin = std::chrono::steady_clock::now();
+        GameArena arena;
+        arena.play(&a, &b, nullptr);
+        latencies.push_back(1e6 * secondsSince(gameBegin));
+    }
+    m.seconds = secondsSince(begin);
+    m.games = games;
+    m.p50Micros = percentile(latencies, 0.50);
+    m.p99Micros = percentile(latencies, 0.99);
+    m.ok = true;
+    return m;
+}
+
+static Measurement qlearnerTraining(const Options& options) {
+    Measurement m;
+    auto q = QLearner::tryCreate(options.rules, 4);
+    if(!q) return m;
+    RandomPlayer r(options.rules, 5);
+    const int chunk = 10000;
+    const int maxGames = scaled(options, 2000000);
+    int games = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while(games < maxGames && q->confidence() < options.targetConfidence) {
+        Tourney::play2v2(chunk, &r, q.get(), Tourney::Params { false, true });
+        games += chunk;
+    }
+    m.seconds = secondsSince(begin);
+    m.games = games;
+    m.gamesToTarget = games;
+    m.ok = q->confidence() >= options.targetConfidence;
+    return m;
+}
+
+static Measurement shapleyConstruction(const Options& options) {
+    Measurement m;
+    auto begin = std::chrono::steady_clock::now();
+    auto shapley = ShapleyPlayer::tryCreate(options.rules, 7, ShapleyPlayer::Params{});
+    m.seconds = secondsSince(begin);
+    m.ok = !!shapley;
+    return m;
+}
+
+static Measurement tourneyTestD(const Options& options) {
+    Measurement m;
+    const Rules& rules = options.rules;
+    RandomPlayer random(rules, 0);
+    BiasedRandomPlayer reloader(rules, 1, 5, 1, 1);
+    BiasedRandomPlayer protective(rules, 2, 1, 5, 1);
+    BiasedRandomPlayer aggressive(rules, 3, 1, 1, 5);
+    auto qlearner = QLearner::tryCreate(rules, 4);
+    auto trained = trainedQLearner(rules, 5);
+    BilinearPlayer bilinear(rules, 6);
+    auto shapley = ShapleyPlayer::tryCreate(rules, 7, ShapleyPlayer::Params{});
+    if(!qlearner || !trained || !shapley) return m;
+
+    Tourney tourney;
+    tourney.addPlayer("[NS] pure random", &random);
+    tourney.addPlayer("[NS] random b/reload", &reloader);
+    tourney.addPlayer("[NS] random b/shield", &protective);
+    tourney.addPlayer("[NS] random b/shoot", &aggressive);
+    tourney.addPlayer("[NS] base qlearner", qlearner.get());
+    tourney.addPlayer("[NS] trained qlearner", trained.get());
+    tourney.addPlayer("[NS] bilinear", &bilinear);
+    tourney.addPlayer("[NS] shapley", shapley.get());
+
+    const int rounds = scaled(options, 1000);
+    const int nbPlayers = 8;
+    auto begin = std::chrono::steady_clock::now();
+    tourney.run(rounds, nullptr);
+    m.seconds = secondsSince(begin);
+    m.games = (double)rounds * nbPlayers * (nbPlayers - 1);
+    m.ok = true;
+    return m;
+}
+
+// Runs the scenario in a child process, *peakRssKb receives its peak resident set
+static Measurement runIsolated(Measurement (*scenario)(const Options&), const Options& options, long* peakRssKb) {
+    Measurement m;
+    int fds[2];
+    if(pipe(fds) != 0) return m;
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return m;
+    }
+    if(pid == 0) {
+        close(fds[0]);
+        Measurement result = scenario(options);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], &m, sizeof(m));
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage;
+    if(wait4(pid, &status, 0, &usage) < 0 || got != (ssize_t)sizeof(m) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return Measurement{};
+    }
+    *peakRssKb = usage.ru_maxrss; // kilobytes on Linux
+    return m;
+}
+
+static ScenarioResult runScenario(const Options& options, const std::string& name, Measurement (*scenario)(const Options&)) {
+    ScenarioResult result;
+    result.name = name;
+    std::vector<Measurement> measurements;
+    long peakRssKb = 0;
+    for(int r = 0; r < options.repetitions; ++r) {
+        long rss = 0;
+        Measurement m = runIsolated(scenario, options, &rss);
+        if(!m.ok) return result;
+        measurements.push_back(m);
+        peakRssKb = std::max(peakRssKb, rss);
+    }
+    std::sort(measurements.begin(), measurements.end(), [](const Measurement& a, const Measurement& b) { return a.seconds < b.seconds; });
+    const Measurement& m = measurements[measurements.size() / 2];
+    result.ok = true;
+    if(m.games > 0) result.metrics.push_back(Metric { "games_per_second", m.games / m.seconds, true, false });
+    result.metrics.push_back(Metric { "seconds", m.seconds, false, false });
+    if(m.p50Micros > 0) result.metrics.push_back(Metric { "p50_us", m.p50Micros, false, false });
+    if(m.p99Micros > 0) result.metrics.push_back(Metric { "p99_us", m.p99Micros, false, false });
+    if(m.gamesToTarget > 0) result.metrics.push_back(Metric { "games_to_target", m.gamesToTarget, false, false });
+    result.metrics.push_back(Metric { "peak_rss_kb", (double)peakRssKb, false, true });
+    return result;
+}
+
+static bool isSelected(const Options& options, const std::string& name) {
+    return options.scenarios.empty() || std::find(options.scenarios.begin(), options.scenarios.end(), name) != options.scenarios.end();
+}
+
+static void writeJson(const Options& options, const std::vector<ScenarioResult>& results) {
+    std::FILE* file = std::fopen(options.jsonFile.c_str(), "w");
+    if(!file) {
+        fmt::print(stderr, "Unable to open {}\n", options.jsonFile);
+        return;
+    }
+    fmt::print(file, "{{\n  \"repetitions\": {},\n  \"scale\": {},\n  \"rules\": [{}, {}, {}],\n  \"results\": [\n",
+               options.repetitions, options.scale, options.rules.startLives, options.rules.maxBullets, options.rules.maxShields);
+    for(size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        fmt::print(file, "    {{\"scenario\": \"{}\", \"ok\": {}", r.name, r.ok ? "true" : "false");
+        for(const auto& metric : r.metrics) fmt::print(file, ", \"{}\": {}", metric.name, metric.value);
+        fmt::print(file, "}}{}\n", i+1 < results.size() ? "," : "");
+    }
+    fmt::print(file, "  ]\n}}\n");
+    std::fclose(file);
+}
+
+static void saveBaseline(const Options& options, const std::vector<ScenarioResult>& results) {
+    std::FILE* file = std::fopen(options.saveBaselineFile.c_str(), "w");
+    if(!file) {
+        fmt::print(stderr, "Unable to open {}\n", options.saveBaselineFile);
+        return;
+    }
+    for(const auto& r : results) {
+        for(const auto& metric : r.metrics) fmt::print(file, "{} {} {}\n", r.name, metric.name, metric.value);
+    }
+    std::fclose(file);
+}
+
+// Number of regressions against the baseline, -1 if it cannot be read
+static int compareWithBaseline(const Options& options, const std::vector<ScenarioResult>& results) {
+    std::ifstream file(options.baselineFile);
+    if(!file) {
+        fmt::print(stderr, "Unable to open {}\n", options.baselineFile);
+        return -1;
+    }
+    std::map<std::pair<std::string, std::string>, double> baseline;
+    std::string scenario;
+    std::string metric;
+    double value = 0;
+    while(file >> scenario >> metric >> value) baseline[{scenario, metric}] = value;
+
+    int regressions = 0;
+    fmt::print("\n{:22} {:18} {:>14} {:>14} {:>8}\n", "scenario", "metric", "baseline", "current", "change");
+    for(const auto& r : results) {
+        if(!r.ok) {
+            fmt::print("{:22} failed\n", r.name);
+            ++regressions;
+            continue;
+        }
+        for(const auto& m : r.metrics) {
+            auto it = baseline.find({r.name, m.name});
+            if(it == baseline.end() || it->second == 0) continue;
+            double change = m.value / it->second - 1;
+            double tolerance = m.memory ? options.rssTolerance : options.tolerance;
+            bool regressed = m.higherIsBetter ? change < -tolerance : change > tolerance;
+            regressions += regressed;
+            fmt::print("{:22} {:18} {:14.4g} {:14.4g} {:+7.1f}%{}\n", r.name, m.name, it->second, m.value, 100*change, regressed ? "  REGRESSION" : "");
+        }
+    }
+    return regressions;
+}
+
+static bool parseOptions(int argc, char** argv, Options* options) {
+    for(int i = 1; i < argc; ++i) {
+        auto is = [&](const char* flag, int nbValues) { return !std::strcmp(argv[i], flag) && i + nbValues < argc; };
+        if(is("--repetitions", 1)) {
+            options->repetitions = std::atoi(argv[++i]);
+        } else if(is("--scale", 1)) {
+            options->scale = std::atof(argv[++i]);
+        } else if(is("--rules", 3)) {
+            options->rules.startLives = std::atoi(argv[++i]);
+            options->rules.maxBullets = std::atoi(argv[++i]);
+            options->rules.maxShields = std::atoi(argv[++i]);
+        } else if(is("--target-confidence", 1)) {
+            options->targetConfidence = std::atof(argv[++i]);
+        } else if(is("--json", 1)) {
+            options->jsonFile = argv[++i];
+        } else if(is("--baseline", 1)) {
+            options->baselineFile = argv[++i];
+        } else if(is("--save-baseline", 1)) {
+            options->saveBaselineFile = argv[++i];
+        } else if(is("--tolerance", 1)) {
+            options->tolerance = std::atof(argv[++i]);
+        } else if(is("--rss-tolerance", 1)) {
+            options->rssTolerance = std::atof(argv[++i]);
+        } else if(is("--scenarios", 1)) {
+            std::string list = argv[++i];
+            size_t begin = 0;
+            while(begin <= list.size()) {
+                size_t end = std::min(list.find(',', begin), list.size());
+                options->scenarios.push_back(list.substr(begin, end - begin));
+                begin = end + 1;
+            }
+        } else {
+            fmt::print(stderr, "Unknown or incomplete option {}\n", argv[i]);
+            return false;
+        }
+    }
+    return options->repetitions > 0 && options->scale > 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if(!parseOptions(argc, argv, &options)) return 2;
+
+    const std::vector<std::pair<std::string, Measurement (*)(const Options&)>> scenarios {
+        { "random-vs-random", &randomVsRandom },
+        { "qlearner-training", &qlearnerTraining },
+        { "shapley-construction", &shapleyConstruction },
+        { "tourney-testD", &tourneyTestD },
+    };
+    std::vector<ScenarioResult> results;
+    for(const auto& scenario : scenarios) {
+        if(!isSelected(options, scenario.first)) continue;
+        results.push_back(runScenario(options, scenario.first, scenario.second));
+        const auto& r = results.back();
+        fmt::print("{:22}", r.name);
+        if(!r.ok) fmt::print(" failed");
+        for(const auto& m : r.metrics) fmt::print("  {}={:.4g}", m.name, m.value);
+        fmt::print("\n");
+    }
+    if(!options.jsonFile.empty()) writeJson(options, results);
+    if(!options.saveBaselineFile.empty()) saveBaseline(options, results);
+
+    bool failed = std::any_of(results.begin(), results.end(), [](const ScenarioResult& r) { return !r.ok; });
+    if(!options.baselineFile.empty()) {
+        int regressions = compareWithBaseline(options, results);
+        if(regressions != 0) return 1;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+#include "tourney.h"
+#include "gamearena.h"
+#include "gamerecording.h"
+#include "fmt/format.h"
+#include <algorithm>
+#include <iterator>
+
+Tourney::Result Tourney::play2v2Lockstep(int rounds, int batch, Player* a, Player* b, const Params& params, int* turns) {
+    Result result;
+    // Same outcome as GameArena::play
+    if(!(a->rules() == b->rules())) {
+        result.ties = std::max(0, rounds);
+        return result;
+    }
+    const Rules& rules = a->rules();
+    const bool withRecording = params.allowLearningA || params.allowLearningB;
+    const size_t slots = (size_t)std::max(0, std::min(rounds, batch));
+    std::vector<GameState> games(slots);
+    std::vector<int> gameRounds(slots, 0);
+    std::vector<int> gameTurns(slots, 0);
+    std::vector<GameRecording> recordings(slots, GameRecording(a, b));
+    std::vector<size_t> running;
+    int started = 0;
+    auto start = [&](size_t slot) {
+        games[slot] = GameState{};
+        gameRounds[slot] = started++;
+        gameTurns[slot] = 0;
+        recordings[slot].clear();
+    };
+    for(size_t slot = 0; slot < slots; ++slot) {
+        start(slot);
+        running.push_back(slot);
+    }
+    std::vector<PlayerState> statesA;
+    std::vector<PlayerState> statesB;
+    std::vector<Action> actionsA;
+    std::vector<Action> actionsB;
+    while(!running.empty()) {
+        statesA.clear();
+        statesB.clear();
+        for(size_t slot : running) {
+            statesA.push_back(games[slot].stateA());
+            statesB.push_back(games[slot].stateB());
+        }
+        actionsA.resize(running.size());
+        actionsB.resize(running.size());
+        a->nextActions(statesA.data(), statesB.data(), actionsA.data(), running.size());
+        b->nextActions(statesB.data(), statesA.data(), actionsB.data(), running.size());
+        size_t stillRunning = 0;
+        for(size_t k = 0; k < running.size(); ++k) {
+            size_t slot = running[k];
+            if(withRecording) recordings[slot].record(actionsA[k], actionsB[k]);
+            if(GameArena::playTurn(&games[slot], &gameTurns[slot], actionsA[k], actionsB[k], rules)) {
+                running[stillRunning++] = slot;
+                continue;
+            }
+            const Player* winner = GameArena::endGame(games[slot], gameTurns[slot], a, b);
+            recordings[slot].recordWinner(winner);
+            endRound(recordings[slot], winner, a, b, params, &result);
+            if(turns) turns[gameRounds[slot]] = gameTurns[slot];
+            if(started < rounds) {
+                start(slot);
+                running[stillRunning++] = slot;
+            }
+        }
+        running.resize(stillRunning);
+    }
+    return result;
+}
+
+void Tourney::addPlayer(const std::string& name, Player* player) {
+    if(!player) return;
+    playerNames_.push_back(name);
+    players_.push_back(player);
+}
+
+void Tourney::run(int roundsPerMatch, std::FILE* out) {
+    fmt::memory_buffer text;
+    auto flush = [&]() {
+        if(out) std::fwrite(text.data(), 1, text.size(), out);
+        text.clear();
+    };
+    Params noLearning { false, false };
+    std::vector<double> playerScores(players_.size(), 0);
+    size_t longestPlayerName = 0;
+    for(const auto& name : playerNames_) longestPlayerName = std::max(longestPlayerName, name.size());
+    for(size_t i = 0; i < players_.size(); ++i) {
+        fmt::format_to(std::back_inserter(text), "{:{}}  ", playerNames_[i], (int)longestPlayerName);
+        for(size_t j = 0; j < players_.size(); ++j) {
+            if(i == j) {
+                fmt::format_to(std::back_inserter(text), "      ");
+                continue;
+            }
+            auto result = playMatch(roundsPerMatch, players_[i], players_[j], noLearning, nullptr);
+            playerScores[i] += result.winsA;
+            playerScores[j] += result.winsB;
+            fmt::format_to(std::back_inserter(text), "{:.2f}  ", 1.0*result.winsA/roundsPerMatch);
+            if(result.winsA > result.winsB) {
+                playerScores[i] += 500;
+            } else if (result.winsB > result.winsA) {
+                playerScores[j] += 500;
+            } else {
+                playerScores[i] += 100;
+                playerScores[j] += 100;
+            }
+        }
+        fmt::format_to(std::back_inserter(text), "\n");
+        flush();
+    }
+    fmt::format_to(std::back_inserter(text), "\n");
+    std::vector<std::pair<double, std::string>> scoredPlayers;
+    scoredPlayers.reserve(players_.size());
+    for(size_t i = 0; i < players_.size(); ++i) {
+        scoredPlayers.emplace_back(playerScores[i],playerNames_[i]);
+    }
+    std::sort(scoredPlayers.begin(), scoredPlayers.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    fmt::format_to(std::back_inserter(text), "Ranked by score:\n");
+    for(const auto& sp : scoredPlayers) {
+        fmt::format_to(std::back_inserter(text), "{:{}} : {:8}\n", sp.second, longestPlayerName, sp.first);
+    }
+    flush();
+}
+
+Tourney::Result Tourney::playMatch(int rounds, Player* a, Player* b, const Params& params, int* turns) {
+    Result result;
+    GameRecording recording(a, b);
+    bool withRecording = params.allowLearningA || params.allowLearningB;
+    for(int round = 0; round < rounds; ++round) {
+        GameArena arena;
+        const Player* winner = arena.play(a, b, withRecording ? &recording : nullptr);
+        if(turns) turns[round] = arena.turns();
+        endRound(recording, winner, a, b, params, &result);
+    }
+    return result;
+}
+
+void Tourney::endRound(const GameRecording& recording, const Player* winner, Player* a, Player* b, const Params& params, Result* result) {
+    if(params.allowLearningA) a->learnFromGame(recording);
+    if(params.allowLearningB) b->learnFromGame(recording);
+    if(!winner) ++result->ties;
+    if(winner == a) ++result->winsA;
+    if(winner == b) ++result->winsB;
+}
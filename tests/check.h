@@ -0,0 +1,20 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "fmt/core.h"
+
+// Counts and reports failed checks, a test returns checkFailures() != 0
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            fmt::print("{}:{}: check failed: {}\n", __FILE__, __LINE__, #condition); \
+            ++checkFailures(); \
+        } \
+    } while(0)
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SHAPLEYTABLES_H
+#define SHAPLEYTABLES_H
+
+#include "players/shapley.h"
+#include <cmath>
+
+inline double valueOf(const ShapleyPlayer::Tables& t, size_t node) {
+    return t.singlePrecision ? ((const float*)t.values)[node] : ((const double*)t.values)[node];
+}
+
+inline double thresholdOf(const ShapleyPlayer::Tables& t, size_t node, int action) {
+    return t.singlePrecision ? ((const float*)t.thresholds)[3*node+action] : ((const double*)t.thresholds)[3*node+action];
+}
+
+// Finite values and cumulative probabilities ending at 1 in every state
+inline bool isSolved(const ShapleyPlayer& player) {
+    auto t = player.tables();
+    if(t.nodes == 0) return false;
+    for(size_t node = 0; node < t.nodes; ++node) {
+        if(!std::isfinite(valueOf(t, node))) return false;
+        double previous = 0;
+        for(int action = 0; action < 3; ++action) {
+            double threshold = thresholdOf(t, node, action);
+            if(!(threshold >= previous - 1e-6)) return false;
+            previous = threshold;
+        }
+        if(std::abs(previous - 1) > 1e-5) return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "check.h"
+#include "players/bilinear.h"
+#include <array>
+#include <cmath>
+#include <vector>
+
+static double playerStateValue(const Rules& rules, const PlayerState& s) {
+    return (rules.maxShields+1)*((rules.maxBullets+1)*s.lives() + s.bullets()) + s.remainingShields();
+}
+
+// Value for A of the stage games looked ahead depth turns, without any table
+static StrategyPoint bruteForce(const Rules& rules, const GameState& s, int depth) {
+    std::array<std::array<double, 3>, 3> payoff;
+    for(int a = 0; a < 3; ++a) {
+        for(int b = 0; b < 3; ++b) {
+            GameState t = s;
+            t.resolve((Action)a, (Action)b, rules);
+            if(t.gameOver()) {
+                payoff[a][b] = t.stateA().lives() > 0 ? -1000 : t.stateB().lives() > 0 ? +1000 : 0.0;
+            } else {
+                payoff[a][b] = playerStateValue(rules, t.stateB()) - playerStateValue(rules, t.stateA())
+                             - playerStateValue(rules, s.stateB()) + playerStateValue(rules, s.stateA());
+                if(depth > 1) payoff[a][b] += bruteForce(rules, t, depth-1).value;
+            }
+        }
+    }
+    return BilinearMinMax::solve(payoff);
+}
+
+static bool same(const Point& p, const Point& q) {
+    for(int i = 0; i < 3; ++i) {
+        if(std::abs(p.p[i] - q.p[i]) > 1e-9) return false;
+    }
+    return true;
+}
+
+static const std::vector<std::pair<PlayerState, PlayerState>> STATES = {
+    { PlayerState::from(5, 0, 5), PlayerState::from(5, 0, 5) },
+    { PlayerState::from(2, 3, 1), PlayerState::from(4, 0, 5) },
+    { PlayerState::from(1, 1, 0), PlayerState::from(1, 2, 3) },
+    { PlayerState::from(3, 5, 2), PlayerState::from(2, 4, 0) },
+};
+
+// Depth 2 backs up the depth-1 stage values of the successors
+static void checkDepthTwo() {
+    Rules rules;
+    for(const auto& [mine, opponent] : STATES) {
+        BilinearPlayer player(rules, 1, BilinearPlayer::Params{ 2, 0.0, 1 << 16 });
+        Point strategy = player.searchStrategy(mine, opponent);
+        CHECK(player.lastSearch().depth == 2);
+        CHECK(same(strategy, bruteForce(rules, GameState::from(mine, opponent), 2).p));
+    }
+}
+
+// The same search again finds the successors in the table, also when it holds a single bucket
+static void checkTranspositions() {
+    Rules rules;
+    for(size_t entries : { (size_t)2, (size_t)1 << 16 }) {
+        BilinearPlayer player(rules, 1, BilinearPlayer::Params{ 3, 0.0, entries });
+        player.searchStrategy(STATES[0].first, STATES[0].second);
+        BilinearPlayer::SearchStats before = player.lastSearch();
+        player.searchStrategy(STATES[0].first, STATES[0].second);
+        BilinearPlayer::SearchStats after = player.lastSearch();
+        CHECK(after.transpositionHits > before.transpositionHits);
+        CHECK(after.depth == 3 && before.depth == 3);
+        // A large table keeps every successor, whose subtrees are then skipped
+        if(entries > 2) CHECK(after.nodes < before.nodes);
+    }
+    // The first slot keeps the deepest value: a single bucket still holds a successor searched at depth 2
+    for(const auto& [mine, opponent] : STATES) {
+        BilinearPlayer tiny(rules, 1, BilinearPlayer::Params{ 3, 0.0, 2 });
+        tiny.searchStrategy(mine, opponent);
+        tiny.searchStrategy(mine, opponent);
+        CHECK(tiny.lastSearch().transpositionHits >= 1);
+    }
+}
+
+// A spent budget plays the depth-1 policy, an exhausted one the deepest completed search
+static void checkBudget() {
+    Rules rules;
+    for(const auto& [mine, opponent] : STATES) {
+        BilinearPlayer spent(rules, 1, BilinearPlayer::Params{ 2, 1e-12, 1 << 16 });
+        Point strategy = spent.searchStrategy(mine, opponent);
+        CHECK(spent.lastSearch().depth == 1);
+        CHECK(same(strategy, BilinearPolicy::computeStrategy(rules, mine, opponent)));
+    }
+    BilinearPlayer aborted(rules, 1, BilinearPlayer::Params{ 1000, 0.02, 1 << 10 });
+    Point strategy = aborted.searchStrategy(STATES[0].first, STATES[0].second);
+    int depth = aborted.lastSearch().depth;
+    CHECK(depth < 1000);
+    // The deepest completed search is what an unbounded search of that depth finds
+    BilinearPlayer complete(rules, 1, BilinearPlayer::Params{ depth, 0.0, 1 << 10 });
+    CHECK(same(strategy, complete.searchStrategy(STATES[0].first, STATES[0].second)));
+    CHECK(complete.lastSearch().depth == depth);
+}
+
+int main() {
+    checkDepthTwo();
+    checkTranspositions();
+    checkBudget();
+    return checkFailures() != 0;
+}
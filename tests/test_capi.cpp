@@ -2,14 +2,14 @@
 #include "fmt/core.h"
 
 int main() {
-    JBPlayer* p0 = jb_createPlayer(JBPlayerType::RANDOM, 0);
-    JBPlayer* p1 = jb_createPlayer(JBPlayerType::QLEARNER, 1);
+    JBRules* rules = jb_createRules(5, 5, 5, 1000);
+
+    JBPlayer* p0 = jb_createPlayer(JBPlayerType::RANDOM, rules, 0);
+    JBPlayer* p1 = jb_createPlayer(JBPlayerType::QLEARNER, rules, 1);
 
     JBPlayerState* s0 = jb_createState(5, 0, 0);
     JBPlayerState* s1 = jb_createState(5, 0, 0);
 
-    JBRules* rules = jb_createRules(5, 5, 5);
-
     auto onReturn = [&]() {
         jb_destroyPlayer(p0);
         jb_destroyPlayer(p1);
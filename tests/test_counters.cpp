@@ -0,0 +1,53 @@
+#include "capi.h"
+#include "check.h"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+static std::vector<unsigned long long> readCounters() {
+    std::vector<unsigned long long> values(JB_NB_COUNTERS, 0);
+    CHECK(jb_readCounters(values.data(), JB_NB_COUNTERS) == JBError::NONE);
+    return values;
+}
+
+// The game counters of a match add up to its result and turns, played one game at a time or in lockstep
+static void checkGames(int maxTurns, int batch) {
+    const int games = 200;
+    JBRules* rules = jb_createRules(5, 5, 5, maxTurns);
+    JBPlayer* a = jb_createPlayer(JBPlayerType::RANDOM, rules, 1);
+    JBPlayer* b = jb_createPlayer(JBPlayerType::RANDOM, rules, 2);
+    JBMatchResult result;
+    std::vector<int> turns(games, 0);
+    jb_resetCounters();
+    if(batch > 0) {
+        CHECK(jb_playGamesLockstep(a, b, games, batch, 0, 0, &result, turns.data()) == JBError::NONE);
+    } else {
+        CHECK(jb_playGames(a, b, games, 0, 0, &result, turns.data()) == JBError::NONE);
+    }
+    std::vector<unsigned long long> c = readCounters();
+    CHECK(c[COUNTER_GAMES_WON_A] + c[COUNTER_GAMES_WON_B] + c[COUNTER_GAMES_TIED] == (unsigned long long)games);
+    CHECK(c[COUNTER_GAMES_WON_A] == (unsigned long long)result.winsA);
+    CHECK(c[COUNTER_GAMES_WON_B] == (unsigned long long)result.winsB);
+    CHECK(c[COUNTER_GAMES_TIED] == (unsigned long long)result.ties);
+    CHECK(c[COUNTER_TURNS_SIMULATED] == (unsigned long long)std::accumulate(turns.begin(), turns.end(), 0LL));
+    // A game can also end by a death on its last allowed turn
+    long long atLimit = std::count(turns.begin(), turns.end(), maxTurns);
+    CHECK(c[COUNTER_GAMES_AT_TURN_LIMIT] <= (unsigned long long)atLimit);
+
+    jb_resetCounters();
+    std::vector<unsigned long long> reset = readCounters();
+    CHECK(std::all_of(reset.begin(), reset.end(), [](unsigned long long v) { return v == 0; }));
+    jb_destroyPlayer(a);
+    jb_destroyPlayer(b);
+    jb_destroyRules(rules);
+}
+
+int main() {
+    // Only built with JAMESBOND_COUNTERS
+    CHECK(jb_countersEnabled() == 1);
+    checkGames(1000, 0);
+    checkGames(4, 0);
+    checkGames(1000, 16);
+    checkGames(4, 16);
+    return checkFailures() != 0;
+}
@@ -0,0 +1,136 @@
+#include "capi.h"
+#include "check.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using Observation = std::array<int, JB_OBSERVATION_SIZE>;
+
+// Reloads when empty, shoots otherwise
+static JBAction aggressive(const int* observation) {
+    return observation[1] > 0 ? JBAction::SHOOT : JBAction::RELOAD;
+}
+
+// Shields against a loaded opponent while it can, shoots when loaded, reloads otherwise
+static JBAction careful(const int* observation) {
+    if(observation[4] > 0 && observation[2] > 0) return JBAction::SHIELD;
+    if(observation[1] > 0) return JBAction::SHOOT;
+    return JBAction::RELOAD;
+}
+
+struct Policy {
+    explicit Policy(JBAction (*d)(const int*)) : decide(d) { }
+
+    JBAction (*decide)(const int*);
+    int calls = 0;
+    int largestBatch = 0;
+    std::vector<Observation> seen;
+};
+
+static void callback(void* userData, const int* observations, int count, JBAction* actions) {
+    Policy* policy = (Policy*)userData;
+    ++policy->calls;
+    policy->largestBatch = std::max(policy->largestBatch, count);
+    for(int i = 0; i < count; ++i) {
+        const int* observation = observations + JB_OBSERVATION_SIZE*i;
+        Observation o;
+        std::copy(observation, observation + JB_OBSERVATION_SIZE, o.begin());
+        policy->seen.push_back(o);
+        actions[i] = policy->decide(observation);
+    }
+}
+
+static Observation observe(const JBState& own, const JBState& opponent) {
+    return { own.lives, own.bullets, own.remainingShields, opponent.lives, opponent.bullets, opponent.remainingShields };
+}
+
+// One game lockstepped through foreign players sees the observations of a game replayed
+// with jb_applyActionsToStates: own state first, and the actions the policies chose
+static void checkObservations() {
+    JBRules* rules = jb_createRules(5, 5, 5, 1000);
+    Policy policyA(aggressive);
+    Policy policyB(careful);
+    JBPlayer* a = jb_createForeignPlayer(rules, callback, &policyA);
+    JBPlayer* b = jb_createForeignPlayer(rules, callback, &policyB);
+    CHECK(a && b);
+    JBMatchResult result;
+    int turns = 0;
+    CHECK(jb_playGamesLockstep(a, b, 1, 1, 0, 0, &result, &turns) == JBError::NONE);
+
+    std::vector<Observation> seenA;
+    std::vector<Observation> seenB;
+    JBState sa { 5, 0, 5 };
+    JBState sb { 5, 0, 5 };
+    int turn = 0;
+    while(sa.lives > 0 && sb.lives > 0 && turn < 1000) {
+        seenA.push_back(observe(sa, sb));
+        seenB.push_back(observe(sb, sa));
+        CHECK(jb_applyActionsToStates(rules, &sa, &sb, aggressive(seenA.back().data()), careful(seenB.back().data())) == JBError::NONE);
+        ++turn;
+    }
+    CHECK(turns == turn);
+    CHECK(policyA.seen == seenA);
+    CHECK(policyB.seen == seenB);
+    CHECK(result.winsA + result.winsB + result.ties == 1);
+    CHECK(result.winsA == (sa.lives > 0 && sb.lives <= 0));
+    jb_destroyPlayer(a);
+    jb_destroyPlayer(b);
+    jb_destroyRules(rules);
+}
+
+// Lockstep plays the games of jb_playGames, with one policy call per wave of batch games and turn
+static void checkSameAsPlayGames(int batch) {
+    const int games = 20;
+    JBRules* rules = jb_createRules(5, 5, 5, 1000);
+    Policy policyA(aggressive);
+    Policy policyB(careful);
+    JBPlayer* a = jb_createForeignPlayer(rules, callback, &policyA);
+    JBPlayer* b = jb_createForeignPlayer(rules, callback, &policyB);
+
+    JBMatchResult sequential;
+    std::vector<int> sequentialTurns(games, 0);
+    CHECK(jb_playGames(a, b, games, 0, 0, &sequential, sequentialTurns.data()) == JBError::NONE);
+    CHECK(policyA.largestBatch == 1);
+
+    policyA = Policy(aggressive);
+    JBMatchResult lockstep;
+    std::vector<int> lockstepTurns(games, 0);
+    CHECK(jb_playGamesLockstep(a, b, games, batch, 0, 0, &lockstep, lockstepTurns.data()) == JBError::NONE);
+    CHECK(lockstep.winsA == sequential.winsA);
+    CHECK(lockstep.winsB == sequential.winsB);
+    CHECK(lockstep.ties == sequential.ties);
+    CHECK(lockstepTurns == sequentialTurns);
+    // Every game lasts the same
+    int waves = (games + batch - 1) / batch;
+    CHECK(policyA.largestBatch == std::min(games, batch));
+    CHECK(policyA.calls == waves*sequentialTurns[0]);
+    CHECK((int)policyA.seen.size() == games*sequentialTurns[0]);
+    jb_destroyPlayer(a);
+    jb_destroyPlayer(b);
+    jb_destroyRules(rules);
+}
+
+static void checkErrors() {
+    JBRules* rules = jb_createRules(5, 5, 5, 1000);
+    Policy policy(aggressive);
+    CHECK(!jb_createForeignPlayer(nullptr, callback, &policy));
+    CHECK(!jb_createForeignPlayer(rules, nullptr, &policy));
+    JBPlayer* a = jb_createForeignPlayer(rules, callback, &policy);
+    JBMatchResult result;
+    CHECK(jb_playGamesLockstep(a, nullptr, 1, 1, 0, 0, &result, nullptr) == JBError::INVALID_PLAYER);
+    CHECK(jb_playGamesLockstep(a, a, 1, 0, 0, 0, &result, nullptr) == JBError::INVALID_ARGUMENT);
+    CHECK(jb_playGamesLockstep(a, a, -1, 1, 0, 0, &result, nullptr) == JBError::INVALID_ARGUMENT);
+    CHECK(jb_playGamesLockstep(a, a, 1, 1, 0, 0, nullptr, nullptr) == JBError::INVALID_ARGUMENT);
+    CHECK(policy.calls == 0);
+    jb_destroyPlayer(a);
+    jb_destroyRules(rules);
+}
+
+int main() {
+    checkObservations();
+    checkSameAsPlayGames(1);
+    checkSameAsPlayGames(7);
+    checkSameAsPlayGames(64);
+    checkErrors();
+    return checkFailures() != 0;
+}
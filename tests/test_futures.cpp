@@ -0,0 +1,71 @@
+#include "capi.h"
+#include "check.h"
+#include "shapleytables.h"
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+// An interrupt raised from the start still lets the first sweep complete, and the policy is not cached
+static void checkInterrupted(ShapleyPlayer::Iteration iteration, bool lean) {
+    std::string directory = (std::filesystem::temp_directory_path() / ("jamesbond-test-" + std::to_string(getpid()))).string();
+    ShapleyPlayer::Params params;
+    params.iteration = iteration;
+    params.lean = lean;
+    params.cacheDirectory = directory;
+    int sweeps = 0;
+    params.onIteration = [&](const ShapleyPlayer::IterationReport&) { ++sweeps; };
+    params.interrupt = []() { return true; };
+    auto player = ShapleyPlayer::tryCreate(Rules{}, 1, params);
+    CHECK(player);
+    if(player) CHECK(isSolved(*player));
+    // The layered modes report once per total number of lives, lean solves sweep in place instead
+    bool layered = !lean && (iteration == ShapleyPlayer::Iteration::Retrograde || iteration == ShapleyPlayer::Iteration::Policy);
+    if(!layered) CHECK(sweeps == 1);
+    CHECK(std::filesystem::is_empty(directory));
+    std::filesystem::remove_all(directory);
+}
+
+// A budget spent before the first sweep ends still gives a ready player
+static void checkTinyBudget(JBPlayerType type) {
+    JBRules* rules = jb_createRules(5, 5, 5, 1000);
+    JBBudget budget { 0, 0, 1e-9 };
+    JBPlayerFuture* future = jb_createPlayerAsync(type, rules, 1, &budget);
+    CHECK(future);
+    if(!future) {
+        jb_destroyRules(rules);
+        return;
+    }
+    JBFutureStatus status = JBFutureStatus::FUTURE_RUNNING;
+    CHECK(jb_futureWait(future, -1, &status) == JBError::NONE);
+    CHECK(status == JBFutureStatus::FUTURE_READY);
+    JBProgress progress;
+    CHECK(jb_futureProgress(future, &progress) == JBError::NONE);
+    if(type == JBPlayerType::SHAPLEY) CHECK(progress.steps == 1);
+
+    JBPlayer* player = jb_futureTakePlayer(future);
+    CHECK(player);
+    if(player) {
+        JBPlayerState* own = jb_createState(5, 0, 0);
+        JBPlayerState* opponent = jb_createState(5, 0, 0);
+        JBAction action;
+        CHECK(jb_play(player, own, opponent, rules, &action) == JBError::NONE);
+        // Without bullets nor shields, reloading is the only legal action
+        CHECK(action == JBAction::RELOAD);
+        jb_destroyState(own);
+        jb_destroyState(opponent);
+        jb_destroyPlayer(player);
+    }
+    jb_destroyFuture(future);
+    jb_destroyRules(rules);
+}
+
+int main() {
+    for(auto iteration : { ShapleyPlayer::Iteration::Jacobi, ShapleyPlayer::Iteration::GaussSeidel, ShapleyPlayer::Iteration::Prioritized,
+                           ShapleyPlayer::Iteration::Policy, ShapleyPlayer::Iteration::Retrograde }) {
+        checkInterrupted(iteration, false);
+        checkInterrupted(iteration, true);
+    }
+    checkTinyBudget(JBPlayerType::SHAPLEY);
+    checkTinyBudget(JBPlayerType::QLEARNER);
+    return checkFailures() != 0;
+}
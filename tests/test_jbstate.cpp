@@ -0,0 +1,110 @@
+#include "capi.h"
+#include "check.h"
+#include <vector>
+
+static JBState read(JBPlayerState* state) {
+    JBState s { 0, 0, 0 };
+    jb_lives(state, &s.lives);
+    jb_bullets(state, &s.bullets);
+    jb_remainingShields(state, &s.remainingShields);
+    return s;
+}
+
+static bool same(const JBState& a, const JBState& b) {
+    return a.lives == b.lives && a.bullets == b.bullets && a.remainingShields == b.remainingShields;
+}
+
+static std::vector<JBState> allStates(int lives, int bullets, int shields) {
+    std::vector<JBState> states;
+    for(int l = 0; l <= lives; ++l) {
+        for(int b = 0; b <= bullets; ++b) {
+            for(int s = 0; s <= shields; ++s) states.push_back(JBState { l, b, s });
+        }
+    }
+    return states;
+}
+
+// jb_applyActionsToStates gives the states of jb_applyActions for every pair of states and actions
+static void checkApply() {
+    JBRules* rules = jb_createRules(3, 2, 2, 1000);
+    JBPlayer* a = jb_createPlayer(JBPlayerType::RANDOM, rules, 1);
+    JBPlayer* b = jb_createPlayer(JBPlayerType::RANDOM, rules, 2);
+    const JBAction actions[] = { JBAction::RELOAD, JBAction::SHIELD, JBAction::SHOOT };
+    std::vector<JBState> states = allStates(3, 2, 2);
+    for(const JBState& startA : states) {
+        for(const JBState& startB : states) {
+            for(JBAction actionA : actions) {
+                for(JBAction actionB : actions) {
+                    JBPlayerState* sa = jb_createState(startA.lives, startA.bullets, startA.remainingShields);
+                    JBPlayerState* sb = jb_createState(startB.lives, startB.bullets, startB.remainingShields);
+                    CHECK(jb_applyActions(a, b, sa, sb, actionA, actionB) == JBError::NONE);
+                    JBState plainA = startA;
+                    JBState plainB = startB;
+                    CHECK(jb_applyActionsToStates(rules, &plainA, &plainB, actionA, actionB) == JBError::NONE);
+                    CHECK(same(plainA, read(sa)));
+                    CHECK(same(plainB, read(sb)));
+                    jb_destroyState(sa);
+                    jb_destroyState(sb);
+                }
+            }
+        }
+    }
+    jb_destroyPlayer(a);
+    jb_destroyPlayer(b);
+    jb_destroyRules(rules);
+}
+
+// jb_playState decides as jb_play, here for random players seeded alike
+static void checkPlay() {
+    JBRules* rules = jb_createRules(3, 2, 2, 1000);
+    JBPlayer* p = jb_createPlayer(JBPlayerType::RANDOM, rules, 7);
+    JBPlayer* q = jb_createPlayer(JBPlayerType::RANDOM, rules, 7);
+    std::vector<JBState> states = allStates(3, 2, 2);
+    for(const JBState& own : states) {
+        for(const JBState& opponent : states) {
+            JBPlayerState* so = jb_createState(own.lives, own.bullets, own.remainingShields);
+            JBPlayerState* sp = jb_createState(opponent.lives, opponent.bullets, opponent.remainingShields);
+            JBAction fromHandles;
+            JBAction fromPlain;
+            CHECK(jb_play(p, so, sp, rules, &fromHandles) == JBError::NONE);
+            CHECK(jb_playState(q, own, opponent, &fromPlain) == JBError::NONE);
+            CHECK(fromHandles == fromPlain);
+            jb_destroyState(so);
+            jb_destroyState(sp);
+        }
+    }
+    jb_destroyPlayer(p);
+    jb_destroyPlayer(q);
+    jb_destroyRules(rules);
+}
+
+// States outside the rules are rejected and left untouched
+static void checkInvalid() {
+    JBRules* rules = jb_createRules(3, 2, 2, 1000);
+    JBPlayer* p = jb_createPlayer(JBPlayerType::RANDOM, rules, 1);
+    JBState valid { 3, 0, 2 };
+    JBAction action;
+    for(JBState invalid : { JBState { 4, 0, 2 }, JBState { 3, 3, 2 }, JBState { 3, 0, 3 }, JBState { -1, 0, 0 } }) {
+        CHECK(jb_playState(p, invalid, valid, &action) == JBError::INVALID_STATE);
+        CHECK(jb_playState(p, valid, invalid, &action) == JBError::INVALID_STATE);
+        JBState a = invalid;
+        JBState b = valid;
+        CHECK(jb_applyActionsToStates(rules, &a, &b, JBAction::RELOAD, JBAction::RELOAD) == JBError::INVALID_STATE);
+        CHECK(same(a, invalid) && same(b, valid));
+    }
+    JBState a = valid;
+    JBState b = valid;
+    CHECK(jb_applyActionsToStates(rules, &a, &b, (JBAction)3, JBAction::RELOAD) == JBError::INVALID_ACTION);
+    CHECK(jb_applyActionsToStates(nullptr, &a, &b, JBAction::RELOAD, JBAction::RELOAD) == JBError::INVALID_RULES);
+    CHECK(jb_playState(nullptr, valid, valid, &action) == JBError::INVALID_PLAYER);
+    CHECK(jb_playState(p, valid, valid, nullptr) == JBError::INVALID_ARGUMENT);
+    jb_destroyPlayer(p);
+    jb_destroyRules(rules);
+}
+
+int main() {
+    checkApply();
+    checkPlay();
+    checkInvalid();
+    return checkFailures() != 0;
+}
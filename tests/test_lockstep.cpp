@@ -0,0 +1,89 @@
+#include "check.h"
+#include "tourney.h"
+#include "players/foreign.h"
+#include "players/qlearner.h"
+#include "players/random.h"
+#include <algorithm>
+#include <vector>
+
+// Reloads when empty, shoots otherwise
+static void aggressive(const PlayerState* mine, const PlayerState*, Action* actions, size_t count) {
+    for(size_t i = 0; i < count; ++i) actions[i] = mine[i].bullets() > 0 ? Action::Shoot : Action::Reload;
+}
+
+// Shields against a loaded opponent while it can, shoots when loaded, reloads otherwise
+static void careful(const PlayerState* mine, const PlayerState* opponent, Action* actions, size_t count) {
+    for(size_t i = 0; i < count; ++i) {
+        if(opponent[i].bullets() > 0 && mine[i].remainingShields() > 0) actions[i] = Action::Shield;
+        else if(mine[i].bullets() > 0) actions[i] = Action::Shoot;
+        else actions[i] = Action::Reload;
+    }
+}
+
+// Deterministic foreign players: lockstep gives the games of sequential play, with one policy call per turn
+static void checkSameAsSequential(int batch) {
+    Rules rules;
+    const int rounds = 20;
+    size_t callsA = 0;
+    size_t largestBatch = 0;
+    ForeignPlayer a(rules, [&](const PlayerState* mine, const PlayerState* opponent, Action* actions, size_t count) {
+        ++callsA;
+        largestBatch = std::max(largestBatch, count);
+        aggressive(mine, opponent, actions, count);
+    });
+    ForeignPlayer b(rules, careful);
+    Tourney::Params params { false, false };
+
+    std::vector<int> sequentialTurns(rounds, 0);
+    Tourney::Result sequential = Tourney::play2v2(rounds, &a, &b, params, sequentialTurns.data());
+    size_t sequentialCalls = callsA;
+
+    callsA = 0;
+    largestBatch = 0;
+    std::vector<int> lockstepTurns(rounds, 0);
+    Tourney::Result lockstep = Tourney::play2v2Lockstep(rounds, batch, &a, &b, params, lockstepTurns.data());
+    CHECK(lockstep.winsA == sequential.winsA);
+    CHECK(lockstep.winsB == sequential.winsB);
+    CHECK(lockstep.ties == sequential.ties);
+    CHECK(lockstepTurns == sequentialTurns);
+    CHECK(largestBatch == (size_t)std::min(rounds, batch));
+    // Every game lasts the same, so rounds/batch waves of one call per turn
+    int waves = (rounds + batch - 1) / batch;
+    CHECK(sequentialCalls == (size_t)rounds*sequentialTurns[0]);
+    CHECK(callsA == (size_t)waves*sequentialTurns[0]);
+}
+
+// A foreign player against a native one that learns from the finished games
+static void checkAgainstLearner() {
+    Rules rules;
+    const int rounds = 200;
+    ForeignPlayer a(rules, careful);
+    auto b = QLearner::tryCreate(rules, 1);
+    CHECK(b);
+    if(!b) return;
+    std::vector<int> turns(rounds, 0);
+    Tourney::Result result = Tourney::play2v2Lockstep(rounds, 16, &a, b.get(), Tourney::Params{ false, true }, turns.data());
+    CHECK(result.winsA + result.winsB + result.ties == rounds);
+    CHECK(std::all_of(turns.begin(), turns.end(), [&](int t) { return t >= 1 && t <= rules.maxTurns; }));
+    CHECK(b->confidence() > 0);
+}
+
+// Mismatched rules end every round as a tie, as GameArena::play does
+static void checkMismatchedRules() {
+    Rules rules;
+    Rules other;
+    other.maxBullets = 3;
+    ForeignPlayer a(rules, aggressive);
+    RandomPlayer b(other, 1);
+    Tourney::Result result = Tourney::play2v2Lockstep(5, 4, &a, &b, Tourney::Params{ false, false }, nullptr);
+    CHECK(result.ties == 5 && result.winsA == 0 && result.winsB == 0);
+}
+
+int main() {
+    checkSameAsSequential(1);
+    checkSameAsSequential(7);
+    checkSameAsSequential(64);
+    checkAgainstLearner();
+    checkMismatchedRules();
+    return checkFailures() != 0;
+}
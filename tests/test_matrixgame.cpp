@@ -0,0 +1,78 @@
+#include "check.h"
+#include "bilinearminmax.h"
+#include "matrixgame.h"
+#include "rand.h"
+#include <cmath>
+#include <vector>
+
+static const double TOLERANCE = 1e-7;
+
+static double uniform(Rand& rand) {
+    const int resolution = 1 << 20;
+    return -10.0 + 20.0 * rand.pick(resolution) / resolution;
+}
+
+static bool isDistribution(const double* p, int n) {
+    double sum = 0;
+    for(int i = 0; i < n; ++i) {
+        if(!(p[i] >= -TOLERANCE)) return false;
+        sum += p[i];
+    }
+    return std::abs(sum - 1) < TOLERANCE;
+}
+
+// The row strategy caps the cost at the value and the column strategy secures it
+static bool isEquilibrium(const std::vector<double>& A, int m, int n, const double* x, const double* y, double value) {
+    if(!isDistribution(x, m) || !isDistribution(y, n)) return false;
+    for(int j = 0; j < n; ++j) {
+        double cost = 0;
+        for(int i = 0; i < m; ++i) cost += x[i] * A[i*n+j];
+        if(cost > value + TOLERANCE) return false;
+    }
+    for(int i = 0; i < m; ++i) {
+        double cost = 0;
+        for(int j = 0; j < n; ++j) cost += A[i*n+j] * y[j];
+        if(cost < value - TOLERANCE) return false;
+    }
+    return true;
+}
+
+template<int M, int N>
+static void checkSize(Rand& rand, int games) {
+    MatrixGameSolver<M, N> fixed;
+    MatrixGameSolver<DYNAMIC_SIZE, DYNAMIC_SIZE> dynamic;
+    for(int g = 0; g < games; ++g) {
+        typename MatrixGameSolver<M, N>::Matrix A;
+        std::vector<double> flat;
+        for(auto& row : A) {
+            for(auto& e : row) {
+                // Small integers half of the time, for ties and degenerate games
+                e = g % 2 ? uniform(rand) : (double)(rand.pick(3) - 1);
+                flat.push_back(e);
+            }
+        }
+        auto f = fixed.solve(A);
+        auto d = dynamic.solve(flat, M, N);
+        CHECK(isEquilibrium(flat, M, N, f.rowStrategy.data(), f.columnStrategy.data(), f.value));
+        CHECK(isEquilibrium(flat, M, N, d.rowStrategy.data(), d.columnStrategy.data(), d.value));
+        CHECK(std::abs(f.value - d.value) < TOLERANCE);
+        if constexpr(M == 3 && N == 3) {
+            SolverContext context;
+            StrategyPoint exact = BilinearMinMax::solveExact(A, context);
+            CHECK(std::abs(exact.value - f.value) < 1e-6);
+            CHECK(std::abs(exact.value - d.value) < 1e-6);
+        }
+    }
+}
+
+int main() {
+    Rand rand(0);
+    checkSize<1, 4>(rand, 100);
+    checkSize<2, 2>(rand, 1000);
+    checkSize<2, 5>(rand, 1000);
+    checkSize<3, 3>(rand, 1000);
+    checkSize<4, 2>(rand, 1000);
+    checkSize<4, 6>(rand, 1000);
+    checkSize<6, 6>(rand, 500);
+    return checkFailures() != 0;
+}
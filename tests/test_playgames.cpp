@@ -0,0 +1,98 @@
+#include "capi.h"
+#include "check.h"
+#include <vector>
+
+static int get(JBError (*field)(JBPlayerState*, int*), JBPlayerState* state) {
+    int value = 0;
+    field(state, &value);
+    return value;
+}
+
+// Outcome of a finished game as GameState::winner decides it: 1 when A wins, -1 when B wins, 0 for a tie
+static int outcome(JBPlayerState* a, JBPlayerState* b) {
+    int livesA = get(jb_lives, a);
+    int livesB = get(jb_lives, b);
+    if(livesA <= 0 || livesB <= 0) return (livesA > 0) - (livesB > 0);
+    for(auto field : { jb_lives, jb_bullets, jb_remainingShields }) {
+        int d = get(field, a) - get(field, b);
+        if(d != 0) return d > 0 ? 1 : -1;
+    }
+    return 0;
+}
+
+// The games of jb_playGames, played turn by turn through jb_play and jb_applyActions
+static JBMatchResult playSequentially(JBPlayer* a, JBPlayer* b, JBRules* rules, int games, int maxTurns, std::vector<int>* turns) {
+    JBMatchResult result { 0, 0, 0 };
+    for(int game = 0; game < games; ++game) {
+        JBPlayerState* sa = jb_createState(5, 0, 5);
+        JBPlayerState* sb = jb_createState(5, 0, 5);
+        int turn = 0;
+        while(get(jb_lives, sa) > 0 && get(jb_lives, sb) > 0 && turn < maxTurns) {
+            JBAction actionA;
+            JBAction actionB;
+            CHECK(jb_play(a, sa, sb, rules, &actionA) == JBError::NONE);
+            CHECK(jb_play(b, sb, sa, rules, &actionB) == JBError::NONE);
+            CHECK(jb_applyActions(a, b, sa, sb, actionA, actionB) == JBError::NONE);
+            ++turn;
+        }
+        int o = outcome(sa, sb);
+        result.winsA += o > 0;
+        result.winsB += o < 0;
+        result.ties += o == 0;
+        turns->push_back(turn);
+        jb_destroyState(sa);
+        jb_destroyState(sb);
+    }
+    return result;
+}
+
+// Random players with the same seeds draw the same actions in both loops
+static void checkSameAsSequential(int maxTurns) {
+    const int games = 300;
+    JBRules* rules = jb_createRules(5, 5, 5, maxTurns);
+    JBPlayer* a = jb_createPlayer(JBPlayerType::RANDOM, rules, 1);
+    JBPlayer* b = jb_createPlayer(JBPlayerType::RANDOM, rules, 2);
+    JBMatchResult inLibrary;
+    std::vector<int> libraryTurns(games, 0);
+    CHECK(jb_playGames(a, b, games, 0, 0, &inLibrary, libraryTurns.data()) == JBError::NONE);
+    jb_destroyPlayer(a);
+    jb_destroyPlayer(b);
+
+    a = jb_createPlayer(JBPlayerType::RANDOM, rules, 1);
+    b = jb_createPlayer(JBPlayerType::RANDOM, rules, 2);
+    std::vector<int> sequentialTurns;
+    JBMatchResult sequential = playSequentially(a, b, rules, games, maxTurns, &sequentialTurns);
+    CHECK(inLibrary.winsA == sequential.winsA);
+    CHECK(inLibrary.winsB == sequential.winsB);
+    CHECK(inLibrary.ties == sequential.ties);
+    CHECK(libraryTurns == sequentialTurns);
+    jb_destroyPlayer(a);
+    jb_destroyPlayer(b);
+    jb_destroyRules(rules);
+}
+
+static void checkErrors() {
+    JBRules* rules = jb_createRules(5, 5, 5, 1000);
+    JBRules* other = jb_createRules(5, 3, 5, 1000);
+    JBPlayer* a = jb_createPlayer(JBPlayerType::RANDOM, rules, 1);
+    JBPlayer* b = jb_createPlayer(JBPlayerType::RANDOM, other, 2);
+    JBMatchResult result;
+    CHECK(jb_playGames(nullptr, a, 1, 0, 0, &result, nullptr) == JBError::INVALID_PLAYER);
+    CHECK(jb_playGames(a, b, 1, 0, 0, &result, nullptr) == JBError::INVALID_RULES);
+    CHECK(jb_playGames(a, a, -1, 0, 0, &result, nullptr) == JBError::INVALID_ARGUMENT);
+    CHECK(jb_playGames(a, a, 1, 0, 0, nullptr, nullptr) == JBError::INVALID_ARGUMENT);
+    CHECK(jb_playGames(a, a, 0, 0, 0, &result, nullptr) == JBError::NONE);
+    CHECK(result.winsA == 0 && result.winsB == 0 && result.ties == 0);
+    jb_destroyPlayer(a);
+    jb_destroyPlayer(b);
+    jb_destroyRules(rules);
+    jb_destroyRules(other);
+}
+
+int main() {
+    checkSameAsSequential(1000);
+    // Most games stop at the turn limit and are decided by the tie break
+    checkSameAsSequential(4);
+    checkErrors();
+    return checkFailures() != 0;
+}
@@ -0,0 +1,61 @@
+#include "check.h"
+#include "shapleytables.h"
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+static size_t filesIn(const std::string& directory) {
+    size_t files = 0;
+    for(const auto& entry : std::filesystem::directory_iterator(directory)) files += entry.is_regular_file();
+    return files;
+}
+
+// Rules differing only in startLives: the warm start is already converged and the solve stops
+// after its first sweep, which must still give a complete policy
+static void checkOneSweep(bool lean) {
+    Rules smaller;
+    smaller.startLives = 4;
+    Rules rules;
+    ShapleyPlayer::Params params;
+    params.lean = lean;
+    auto previous = ShapleyPlayer::tryCreate(smaller, 1, params);
+    auto cold = ShapleyPlayer::tryCreate(rules, 1, params);
+    CHECK(previous && cold);
+    if(!previous || !cold) return;
+
+    int sweeps = 0;
+    params.warmStart = previous.get();
+    params.onIteration = [&](const ShapleyPlayer::IterationReport&) { ++sweeps; };
+    auto warm = ShapleyPlayer::tryCreate(rules, 1, params);
+    CHECK(warm);
+    if(!warm) return;
+    CHECK(sweeps == 1);
+    CHECK(isSolved(*warm));
+    CHECK(warm->tables().nodes == cold->tables().nodes);
+}
+
+static void checkNotCached() {
+    std::string directory = (std::filesystem::temp_directory_path() / ("jamesbond-test-" + std::to_string(getpid()))).string();
+    Rules smaller;
+    smaller.startLives = 4;
+    Rules rules;
+    ShapleyPlayer::Params params;
+    auto previous = ShapleyPlayer::tryCreate(smaller, 1, params);
+    params.cacheDirectory = directory;
+    params.warmStart = previous.get();
+    auto warm = ShapleyPlayer::tryCreate(rules, 1, params);
+    CHECK(warm && isSolved(*warm));
+    CHECK(filesIn(directory) == 0);
+    params.warmStart = nullptr;
+    auto cold = ShapleyPlayer::tryCreate(rules, 1, params);
+    CHECK(cold && isSolved(*cold));
+    CHECK(filesIn(directory) == 1);
+    std::filesystem::remove_all(directory);
+}
+
+int main() {
+    checkOneSweep(false);
+    checkOneSweep(true);
+    checkNotCached();
+    return checkFailures() != 0;
+}
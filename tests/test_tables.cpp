@@ -0,0 +1,140 @@
+#include "capi.h"
+#include "check.h"
+#include "shapleytables.h"
+#include "tourney.h"
+#include "players/qlearner.h"
+#include "players/random.h"
+#include <cstdint>
+#include <cstring>
+
+template<typename T>
+static T at(const JBTableView& view, long long i, long long j) {
+    T value;
+    std::memcpy(&value, (const char*)view.data + i*view.strides[0] + j*view.strides[1], sizeof(T));
+    return value;
+}
+
+static double real(const JBTableView& view, long long i, long long j) {
+    return view.type == JBScalarType::FLOAT32 ? at<float>(view, i, j) : at<double>(view, i, j);
+}
+
+static JBPlayer* createPlayer(JBPlayerType type, JBRules* rules, int seed, const JBBudget& budget) {
+    JBPlayerFuture* future = jb_createPlayerAsync(type, rules, seed, &budget);
+    if(!future) return nullptr;
+    JBFutureStatus status = JBFutureStatus::FUTURE_RUNNING;
+    jb_futureWait(future, -1, &status);
+    JBPlayer* player = jb_futureTakePlayer(future);
+    jb_destroyFuture(future);
+    return player;
+}
+
+// The views of a QLEARNER player hold the scores of a QLearner warmed up the same way,
+// at [opponent][own] as QState::configToIndex lays them out
+static void checkQTables() {
+    const int seed = 3;
+    const int games = 1000;
+    JBRules* rules = jb_createRules(5, 5, 5, 1000);
+    JBPlayer* player = createPlayer(JBPlayerType::QLEARNER, rules, seed, JBBudget { games, 0, 0.0 });
+    CHECK(player);
+
+    Rules plainRules;
+    auto q = QLearner::tryCreate(plainRules, seed);
+    RandomPlayer r(plainRules, seed+1);
+    Tourney::play2v2(games, &r, q.get(), Tourney::Params{ false, true });
+
+    const int n = QLearner::STATES_PER_PLAYER;
+    const JBAction actions[] = { JBAction::RELOAD, JBAction::SHIELD, JBAction::SHOOT };
+    for(int a = 0; a < 3 && player; ++a) {
+        JBTableView score;
+        JBTableView confidence;
+        CHECK(jb_qlearnerTable(player, actions[a], JBQTable::QSCORE, &score) == JBError::NONE);
+        CHECK(jb_qlearnerTable(player, actions[a], JBQTable::QCONFIDENCE, &confidence) == JBError::NONE);
+        CHECK(score.type == JBScalarType::FLOAT64 && confidence.type == JBScalarType::INT32);
+        CHECK(score.ndim == 2 && score.shape[0] == n && score.shape[1] == n);
+        CHECK(confidence.ndim == 2 && confidence.shape[0] == n && confidence.shape[1] == n);
+        const auto& scores = q->scores((Action)a);
+        bool visited = false;
+        for(int opponent = 0; opponent < n; ++opponent) {
+            for(int own = 0; own < n; ++own) {
+                const auto& expected = scores[(size_t)own + (size_t)n*opponent];
+                CHECK(at<double>(score, opponent, own) == expected.score);
+                CHECK(at<int32_t>(confidence, opponent, own) == expected.confidence);
+                visited |= expected.confidence > 0;
+            }
+        }
+        CHECK(visited);
+    }
+    JBTableView view;
+    CHECK(jb_qlearnerTable(player, (JBAction)3, JBQTable::QSCORE, &view) == JBError::INVALID_ACTION);
+    CHECK(jb_qlearnerTable(player, JBAction::RELOAD, (JBQTable)2, &view) == JBError::INVALID_ARGUMENT);
+    jb_destroyPlayer(player);
+    jb_destroyRules(rules);
+}
+
+// The views and bounds of a SHAPLEY player are those of ShapleyPlayer::tables() for the same solve
+static void checkShapleyTables() {
+    const int seed = 1;
+    const int iterations = 50;
+    JBRules* rules = jb_createRules(3, 2, 2, 1000);
+    JBPlayer* player = createPlayer(JBPlayerType::SHAPLEY, rules, seed, JBBudget { 0, iterations, 0.0 });
+    CHECK(player);
+    if(!player) {
+        jb_destroyRules(rules);
+        return;
+    }
+
+    Rules plainRules { 3, 2, 2, 1000 };
+    ShapleyPlayer::Params params = ShapleyPlayer::defaultParams();
+    params.maxIterations = iterations;
+    auto s = ShapleyPlayer::tryCreate(plainRules, seed, params);
+    CHECK(s);
+    if(!s) {
+        jb_destroyPlayer(player);
+        jb_destroyRules(rules);
+        return;
+    }
+    ShapleyPlayer::Tables t = s->tables();
+
+    JBTableView values;
+    JBTableView thresholds;
+    JBTableView states;
+    CHECK(jb_shapleyTable(player, JBShapleyTable::SHAPLEY_VALUES, &values) == JBError::NONE);
+    CHECK(jb_shapleyTable(player, JBShapleyTable::SHAPLEY_THRESHOLDS, &thresholds) == JBError::NONE);
+    CHECK(jb_shapleyTable(player, JBShapleyTable::SHAPLEY_STATES, &states) == JBError::NONE);
+    CHECK(values.type == (t.singlePrecision ? JBScalarType::FLOAT32 : JBScalarType::FLOAT64));
+    CHECK(values.ndim == 1 && values.shape[0] == (long long)t.nodes);
+    CHECK(thresholds.ndim == 2 && thresholds.shape[0] == (long long)t.nodes && thresholds.shape[1] == 3);
+    CHECK(states.type == JBScalarType::UINT64);
+    CHECK(states.ndim == 1 && states.shape[0] == (long long)t.stateBitmapWords);
+    for(size_t node = 0; node < t.nodes; ++node) {
+        CHECK(std::abs(real(values, node, 0) - valueOf(t, node)) < 1e-9);
+        for(int action = 0; action < 3; ++action) CHECK(std::abs(real(thresholds, node, action) - thresholdOf(t, node, action)) < 1e-9);
+    }
+    size_t bits = 0;
+    for(size_t w = 0; w < t.stateBitmapWords; ++w) {
+        uint64_t word = at<uint64_t>(states, w, 0);
+        CHECK(word == t.stateBitmap[w]);
+        bits += __builtin_popcountll(word);
+    }
+    CHECK(bits == t.nodes);
+
+    int maxLives = 0;
+    int maxBullets = 0;
+    int maxShields = 0;
+    CHECK(jb_shapleyBounds(player, &maxLives, &maxBullets, &maxShields) == JBError::NONE);
+    CHECK(maxLives == t.maxLives && maxBullets == t.maxBullets && maxShields == t.maxShields);
+    CHECK(jb_shapleyBounds(player, nullptr, &maxBullets, &maxShields) == JBError::INVALID_ARGUMENT);
+
+    JBPlayer* random = jb_createPlayer(JBPlayerType::RANDOM, rules, seed);
+    CHECK(jb_shapleyTable(random, JBShapleyTable::SHAPLEY_VALUES, &values) == JBError::INVALID_PLAYER);
+    CHECK(jb_shapleyBounds(random, &maxLives, &maxBullets, &maxShields) == JBError::INVALID_PLAYER);
+    jb_destroyPlayer(random);
+    jb_destroyPlayer(player);
+    jb_destroyRules(rules);
+}
+
+int main() {
+    checkQTables();
+    checkShapleyTables();
+    return checkFailures() != 0;
+}
@@ -0,0 +1,184 @@
+import ctypes as c_
+import sys
+
+try:
+    import numpy as np
+except ImportError:
+    sys.exit(77)
+
+import ns_jamesbond as jb
+
+failures = 0
+
+def check(condition, what):
+    global failures
+    if not condition:
+        print("check failed: " + what)
+        failures += 1
+
+ENVS = 4
+
+def startObservations(observations):
+    return list(observations) == [5, 0, 5, 5, 0, 5] * ENVS
+
+# Every accepted form of actions steps all the games with the same actions
+def checkVecEnvStep():
+    rules = jb.Rules(5, 5, 5)
+    opponent = jb.Player(jb.PlayerType.RANDOM, rules)
+    env = jb.VecEnv(rules, opponent, ENVS)
+    check(startObservations(env.reset()), "reset observations")
+
+    forms = [
+        [jb.Action.RELOAD] * ENVS,
+        [jb.Action.RELOAD.value] * ENVS,
+        np.full(ENVS, jb.Action.RELOAD.value, dtype=np.int32),
+        np.full(ENVS, jb.Action.RELOAD.value, dtype=np.int64),
+        (c_.c_int * ENVS)(*([jb.Action.RELOAD.value] * ENVS)),
+    ]
+    for turn, actions in enumerate(forms):
+        observations, rewards, dones = env.step(actions)
+        check(all(observations[jb.OBSERVATION_SIZE*i + 1] == turn + 1 for i in range(ENVS)), "bullets after reloading")
+        check(list(dones) == [0] * ENVS and list(rewards) == [0.0] * ENVS, "no game ends while A reloads")
+
+    # Shooting without bullets is illegal and loses, the games restart
+    env.reset()
+    observations, rewards, dones = env.step([jb.Action.SHOOT] * ENVS)
+    check(list(dones) == [1] * ENVS, "illegal action ends the games")
+    check(list(rewards) == [-1.0] * ENVS, "illegal action loses")
+    check(startObservations(observations), "ended games restart")
+
+    for bad in ([jb.Action.RELOAD] * (ENVS - 1), np.zeros(ENVS, dtype=np.float32), (c_.c_int * (ENVS + 1))()):
+        try:
+            env.step(bad)
+            check(False, "rejects {}".format(type(bad).__name__))
+        except jb.JBException:
+            pass
+
+    # Random legal play: a reward is only given when the game ends
+    env.reset()
+    rng = np.random.default_rng(1)
+    for _ in range(500):
+        observations, rewards, dones = env.step(rng.integers(0, 2, ENVS))
+        for i in range(ENVS):
+            check(rewards[i] in (-1.0, 0.0, 1.0), "reward values")
+            check(rewards[i] == 0.0 or dones[i] == 1, "reward only at the end")
+
+def decode(index):
+    return jb.State(index % 6, index // 6 % 6, index // 36)
+
+def inRules(state, rules):
+    return state.lives <= rules.startLives and state.bullets <= rules.maxBullets and state.remainingShields <= rules.maxRemainingShields
+
+def isLegal(state, action, rules):
+    if action == jb.Action.RELOAD:
+        return state.bullets < rules.maxBullets
+    if action == jb.Action.SHIELD:
+        return state.remainingShields > 0
+    return state.bullets > 0
+
+# Where the scores single out a legal action with enough confidence, the QLEARNER plays it
+def checkQTable():
+    rules = jb.Rules(5, 5, 5)
+    player = jb.PlayerFuture(jb.PlayerType.QLEARNER, rules, games=20000).player()
+    scores = np.stack([player.qTable(a) for a in jb.Action])
+    confidences = np.stack([player.qTable(a, confidence=True) for a in jb.Action])
+    check(scores.shape == (3, 216, 216) and confidences.dtype == np.int32, "qTable shapes")
+    best = np.argmax(scores, axis=0)
+    decided = (confidences.min(axis=0) >= 5) & (scores.max(axis=0) - scores.min(axis=0) >= 1)
+    checked = 0
+    for opponent, own in zip(*np.nonzero(decided)):
+        ownState = decode(own)
+        opponentState = decode(opponent)
+        action = jb.Action(int(best[opponent, own]))
+        if ownState.lives == 0 or opponentState.lives == 0 or not isLegal(ownState, action, rules):
+            continue
+        check(player.playState(ownState, opponentState) == action, "qTable decides at [{}, {}]".format(opponent, own))
+        checked += 1
+    check(checked > 0, "some decided QLEARNER states")
+
+# The decoded states of the SHAPLEY tables are those the player decides in: where the strategy
+# is pure and legal, playState gives its action. The tables also cover the default start state, which
+# playState rejects when it lies outside the rules.
+def checkShapleyTables():
+    rules = jb.Rules(3, 2, 2)
+    player = jb.Player(jb.PlayerType.SHAPLEY, rules)
+    values, thresholds, states = player.shapleyTables()
+    check(len(values) == len(thresholds) == len(states) > 0, "shapleyTables lengths")
+    checked = 0
+    for node in range(len(states)):
+        own = jb.State(*[int(x) for x in states[node, :3]])
+        opponent = jb.State(*[int(x) for x in states[node, 3:]])
+        pure = [action for action, low, high in zip(jb.Action, [0.0] + list(thresholds[node, :2]), thresholds[node])
+                if high - low > 1 - 1e-9]
+        if not pure or not isLegal(own, pure[0], rules) or not inRules(own, rules) or not inRules(opponent, rules):
+            continue
+        check(player.playState(own, opponent) == pure[0], "shapleyTables decides at {}".format(list(states[node])))
+        checked += 1
+    check(checked > 0, "some pure SHAPLEY states")
+
+# Reloads when empty, shoots otherwise
+def aggressive(observation):
+    return jb.Action.SHOOT if observation[1] > 0 else jb.Action.RELOAD
+
+# Shields against a loaded opponent while it can, shoots when loaded, reloads otherwise
+def careful(observation):
+    if observation[4] > 0 and observation[2] > 0:
+        return jb.Action.SHIELD
+    return jb.Action.SHOOT if observation[1] > 0 else jb.Action.RELOAD
+
+# Decides for a batch with decide, recording the batch sizes and the observations
+class Recorder:
+    def __init__(self, decide):
+        self.decide = decide
+        self.batches = []
+        self.seen = []
+
+    def __call__(self, observations, actions):
+        self.batches.append(len(actions))
+        for i, observation in enumerate(observations):
+            self.seen.append(list(observation))
+            actions[i] = self.decide(observation).value
+
+# ForeignPlayer sees its own state first, and playGames gives the same games with or without lockstep
+def checkForeignPlayer():
+    rules = jb.Rules(5, 5, 5)
+    recordA = Recorder(aggressive)
+    recordB = Recorder(careful)
+    a = jb.ForeignPlayer(rules, recordA)
+    b = jb.ForeignPlayer(rules, recordB)
+    sequential, sequentialTurns = jb.playGames(a, b, 1, withTurns=True)
+
+    s0 = jb.State(5, 0, 5)
+    s1 = jb.State(5, 0, 5)
+    seenA = []
+    seenB = []
+    while s0.lives > 0 and s1.lives > 0:
+        seenA.append([s0.lives, s0.bullets, s0.remainingShields, s1.lives, s1.bullets, s1.remainingShields])
+        seenB.append(seenA[-1][3:] + seenA[-1][:3])
+        jb.applyActionsToStates(rules, s0, s1, aggressive(seenA[-1]), careful(seenB[-1]))
+    check(recordA.seen == seenA and recordB.seen == seenB, "foreign observations")
+    check(sequentialTurns == [len(seenA)], "foreign game turns")
+
+    games = 10
+    sequential, sequentialTurns = jb.playGames(a, b, games, withTurns=True)
+    recordA.batches = []
+    lockstep, lockstepTurns = jb.playGames(a, b, games, withTurns=True, lockstep=4)
+    check(lockstep == sequential and lockstepTurns == sequentialTurns, "lockstep plays the same games")
+    check(max(recordA.batches) == 4 and sum(recordA.batches) == sum(lockstepTurns), "lockstep batches")
+
+# playGame decides games stopped at rules.maxTurns with the tie break of the library
+def checkPlayGame():
+    for maxTurns in (1, 2, 3, 5, 8, 1000):
+        rules = jb.Rules(5, 5, 5, maxTurns)
+        a = jb.ForeignPlayer(rules, Recorder(aggressive))
+        b = jb.ForeignPlayer(rules, Recorder(careful))
+        for p0, p1 in ((a, b), (b, a)):
+            inLibrary = jb.playGames(p0, p1, 1)
+            check(inLibrary[jb.playGame(p0, p1, rules)] == 1, "playGame at {} turns".format(maxTurns))
+
+checkVecEnvStep()
+checkForeignPlayer()
+checkPlayGame()
+checkQTable()
+checkShapleyTables()
+sys.exit(1 if failures else 0)
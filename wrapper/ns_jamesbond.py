@@ -29,23 +29,63 @@ class JBException(Exception):
             super(Exception, self).__init__("Invalid state")
         elif errorCode == -4:
             super(Exception, self).__init__("Invalid action")
+        elif errorCode == -5:
+            super(Exception, self).__init__("Invalid argument")
         else:
             super(Exception, self).__init__("Unknown error with code {}".format(errorCode))
 
+# Plain state kept by value, the cheap alternative to PlayerState
+class State(c_.Structure):
+    _fields_ = [("lives", c_.c_int), ("bullets", c_.c_int), ("remainingShields", c_.c_int)]
+
+# Declared once: these are the per-turn calls, and State is passed by value
+c_lib.jb_playState.restype = c_.c_int
+c_lib.jb_playState.argtypes = [c_.c_void_p, State, State, c_.POINTER(c_.c_int)]
+c_lib.jb_applyActionsToStates.restype = c_.c_int
+c_lib.jb_applyActionsToStates.argtypes = [c_.c_void_p, c_.POINTER(State), c_.POINTER(State), c_.c_int, c_.c_int]
+
+class MatchResult(c_.Structure):
+    _fields_ = [("winsA", c_.c_int), ("winsB", c_.c_int), ("ties", c_.c_int)]
+
+class TableView(c_.Structure):
+    _fields_ = [("data", c_.c_void_p), ("type", c_.c_int), ("ndim", c_.c_int),
+                ("shape", c_.c_longlong * 2), ("strides", c_.c_longlong * 2)]
+
+# typestr of JBScalarType values, native byte order
+SCALAR_TYPESTRS = ["=f4", "=f8", "=i4", "=u8"]
+
+# Exposes a TableView through the array interface, keeping its owner alive as long as the arrays
+class _TableHolder:
+    def __init__(self, owner, view):
+        self.owner = owner
+        ndim = view.ndim
+        self.__array_interface__ = {
+            "version": 3,
+            "shape": tuple(view.shape[:ndim]),
+            "strides": tuple(view.strides[:ndim]),
+            "typestr": SCALAR_TYPESTRS[view.type],
+            "data": (view.data or 0, True),
+        }
+
+def _asNumpy(owner, view):
+    import numpy as np
+    return np.asarray(_TableHolder(owner, view))
+
 class Rules:
-    def __init__(self, startLives, maxBullets, maxRemainingShields):
+    def __init__(self, startLives, maxBullets, maxRemainingShields, maxTurns=1000):
         c_lib.jb_createRules.restype = c_.c_void_p
-        self.c_rules = c_lib.jb_createRules(c_.c_int(startLives), c_.c_int(maxBullets), c_.c_int(maxRemainingShields))
+        self.c_rules = c_lib.jb_createRules(c_.c_int(startLives), c_.c_int(maxBullets), c_.c_int(maxRemainingShields), c_.c_int(maxTurns))
         self.startLives = startLives
         self.maxBullets = maxBullets
         self.maxRemainingShields = maxRemainingShields
+        self.maxTurns = maxTurns
 
     def __del__(self):
         c_lib.jb_destroyRules.restype = None
         c_lib.jb_destroyRules(c_.c_void_p(self.c_rules))
 
     def __eq__(self, other): 
-        return self.startLives == other.startLives and self.maxBullets == other.maxBullets and self.maxRemainingShields == other.maxRemainingShields
+        return self.startLives == other.startLives and self.maxBullets == other.maxBullets and self.maxRemainingShields == other.maxRemainingShields and self.maxTurns == other.maxTurns
 
 class PlayerState:
     def __init__(self, lives, bullets, remainingShields):
@@ -81,10 +121,12 @@ class PlayerState:
         return remainingShields.value
 
 class Player:
-    def __init__(self, type, rules):
-        seed = rd.randint(0, 1000)
-        c_lib.jb_createPlayer.restype = c_.c_void_p
-        self.c_player = c_lib.jb_createPlayer(c_.c_int(type.value), c_.c_void_p(rules.c_rules), c_.c_int(seed))
+    def __init__(self, type, rules, c_player=None):
+        if c_player is None:
+            seed = rd.randint(0, 1000)
+            c_lib.jb_createPlayer.restype = c_.c_void_p
+            c_player = c_lib.jb_createPlayer(c_.c_int(type.value), c_.c_void_p(rules.c_rules), c_.c_int(seed))
+        self.c_player = c_player
         self.rules = rules
 
     def __del__(self):
@@ -99,6 +141,179 @@ class Player:
             raise JBException(ec)
         return Action(action.value)
 
+    def playState(self, ownState, opponentState):
+        action = c_.c_int()
+        ec = c_lib.jb_playState(c_.c_void_p(self.c_player), ownState, opponentState, c_.byref(action))
+        if ec < 0:
+            raise JBException(ec)
+        return Action(action.value)
+
+    # Read-only NumPy views of a QLEARNER's scores (float64) or visit counts (int32) for an action,
+    # indexed [opponent, own] with index = lives + 6*bullets + 36*remainingShields. No copy is made.
+    def qTable(self, action, confidence=False):
+        view = TableView()
+        c_lib.jb_qlearnerTable.restype = c_.c_int
+        ec = c_lib.jb_qlearnerTable(c_.c_void_p(self.c_player), c_.c_int(action.value), c_.c_int(1 if confidence else 0), c_.byref(view))
+        if ec < 0:
+            raise JBException(ec)
+        return _asNumpy(self, view)
+
+    # Read-only NumPy views of a SHAPLEY player's solved policy, without copy:
+    # (values, thresholds, states) where row i of values and thresholds belongs to states[i],
+    # an (nodes, 6) int array of lives, bullets and remaining shields of both players.
+    # Decoding the states is the only part done in Python.
+    def shapleyTables(self):
+        import numpy as np
+        views = []
+        for table in range(3):
+            view = TableView()
+            c_lib.jb_shapleyTable.restype = c_.c_int
+            ec = c_lib.jb_shapleyTable(c_.c_void_p(self.c_player), c_.c_int(table), c_.byref(view))
+            if ec < 0:
+                raise JBException(ec)
+            views.append(_asNumpy(self, view))
+        values, thresholds, bitmap = views
+        bounds = [c_.c_int() for _ in range(3)]
+        c_lib.jb_shapleyBounds.restype = c_.c_int
+        ec = c_lib.jb_shapleyBounds(c_.c_void_p(self.c_player), *[c_.byref(b) for b in bounds])
+        if ec < 0:
+            raise JBException(ec)
+        maxLives, maxBullets, maxShields = [b.value for b in bounds]
+        keys = np.flatnonzero(np.unpackbits(bitmap.view(np.uint8), bitorder="little"))
+        statesPerPlayer = maxLives * (maxBullets + 1) * (maxShields + 1)
+        states = np.empty((len(keys), 6), dtype=np.int32)
+        for column, index in ((0, keys // statesPerPlayer), (3, keys % statesPerPlayer)):
+            states[:, column + 2] = index % (maxShields + 1)
+            index = index // (maxShields + 1)
+            states[:, column + 1] = index % (maxBullets + 1)
+            states[:, column] = index // (maxBullets + 1) + 1
+        return values, thresholds, states
+
+
+OBSERVATION_SIZE = 6
+
+# envs games against opponent, stepped together. Observations, rewards and dones are ctypes arrays
+# owned by the environment and overwritten by every call; numpy.ctypeslib.as_array gives views on them.
+class VecEnv:
+    def __init__(self, rules, opponent, envs):
+        c_lib.jb_createVecEnv.restype = c_.c_void_p
+        self.c_env = c_lib.jb_createVecEnv(c_.c_void_p(rules.c_rules), c_.c_void_p(opponent.c_player), c_.c_int(envs))
+        if not self.c_env:
+            raise JBException(-5)
+        self.opponent = opponent
+        self.envs = envs
+        self.actions = (c_.c_int * envs)()
+        self.observations = (c_.c_int * (envs * OBSERVATION_SIZE))()
+        self.rewards = (c_.c_float * envs)()
+        self.dones = (c_.c_int * envs)()
+
+    def __del__(self):
+        c_lib.jb_destroyVecEnv.restype = None
+        c_lib.jb_destroyVecEnv(c_.c_void_p(self.c_env))
+
+    def reset(self):
+        c_lib.jb_vecEnvReset.restype = c_.c_int
+        ec = c_lib.jb_vecEnvReset(c_.c_void_p(self.c_env), self.observations)
+        if ec < 0:
+            raise JBException(ec)
+        return self.observations
+
+    # actions holds one action per game: a NumPy integer array or a ctypes c_int array, copied
+    # as a block, or a sequence of Action members or their values
+    def step(self, actions):
+        size = c_.sizeof(self.actions)
+        if isinstance(actions, c_.Array):
+            if actions._type_ is not c_.c_int or len(actions) != self.envs:
+                raise JBException(-5)
+            c_.memmove(self.actions, actions, size)
+        else:
+            import numpy as np
+            if not isinstance(actions, np.ndarray):
+                actions = [a.value if isinstance(a, Action) else a for a in actions]
+            actions = np.asarray(actions)
+            if not np.issubdtype(actions.dtype, np.integer) or actions.shape != (self.envs,):
+                raise JBException(-5)
+            values = np.ascontiguousarray(actions, dtype=np.int32)
+            c_.memmove(self.actions, values.ctypes.data, size)
+        c_lib.jb_vecEnvStep.restype = c_.c_int
+        ec = c_lib.jb_vecEnvStep(c_.c_void_p(self.c_env), self.actions, self.observations, self.rewards, self.dones)
+        if ec < 0:
+            raise JBException(ec)
+        return self.observations, self.rewards, self.dones
+
+POLICY_CALLBACK = c_.CFUNCTYPE(None, c_.c_void_p, c_.POINTER(c_.c_int), c_.c_int, c_.POINTER(c_.c_int))
+
+# Player deciding in Python. policy(observations, actions) gets NumPy views of the batch:
+# observations (count, OBSERVATION_SIZE) int32 from the player's side, and actions (count,)
+# int32 to fill with Action values. The views are only valid during the call.
+class ForeignPlayer(Player):
+    def __init__(self, rules, policy):
+        import numpy as np
+        def callback(userData, observations, count, actions):
+            policy(np.ctypeslib.as_array(observations, shape=(count, OBSERVATION_SIZE)),
+                   np.ctypeslib.as_array(actions, shape=(count,)))
+        # Kept alive as long as the player, the library calls it
+        self.callback = POLICY_CALLBACK(callback)
+        c_lib.jb_createForeignPlayer.restype = c_.c_void_p
+        super().__init__(None, rules, c_lib.jb_createForeignPlayer(c_.c_void_p(rules.c_rules), self.callback, None))
+
+class Budget(c_.Structure):
+    _fields_ = [("games", c_.c_int), ("iterations", c_.c_int), ("seconds", c_.c_double)]
+
+class Progress(c_.Structure):
+    _fields_ = [("status", c_.c_int), ("steps", c_.c_longlong), ("budget", c_.c_longlong),
+                ("residual", c_.c_double), ("seconds", c_.c_double)]
+
+class FutureStatus(Enum):
+    RUNNING = 0
+    READY = 1
+    FAILED = 2
+    CANCELLED = 3
+
+# Player constructed on a background thread. Budget fields left at 0 keep the defaults of Player.
+class PlayerFuture:
+    def __init__(self, type, rules, games=0, iterations=0, seconds=0.0):
+        seed = rd.randint(0, 1000)
+        budget = Budget(games, iterations, seconds)
+        c_lib.jb_createPlayerAsync.restype = c_.c_void_p
+        self.c_future = c_lib.jb_createPlayerAsync(c_.c_int(type.value), c_.c_void_p(rules.c_rules), c_.c_int(seed), c_.byref(budget))
+        if not self.c_future:
+            raise JBException(-5)
+        self.type = type
+        self.rules = rules
+        self.taken = None
+
+    def __del__(self):
+        c_lib.jb_destroyFuture.restype = None
+        c_lib.jb_destroyFuture(c_.c_void_p(self.c_future))
+
+    def progress(self):
+        progress = Progress()
+        c_lib.jb_futureProgress.restype = c_.c_int
+        ec = c_lib.jb_futureProgress(c_.c_void_p(self.c_future), c_.byref(progress))
+        if ec < 0:
+            raise JBException(ec)
+        return progress
+
+    # Waits for at most timeout seconds, forever when None, and returns the FutureStatus
+    def wait(self, timeout=None):
+        status = c_.c_int()
+        c_lib.jb_futureWait.restype = c_.c_int
+        ec = c_lib.jb_futureWait(c_.c_void_p(self.c_future), c_.c_double(-1.0 if timeout is None else timeout), c_.byref(status))
+        if ec < 0:
+            raise JBException(ec)
+        return FutureStatus(status.value)
+
+    def cancel(self):
+        c_lib.jb_futureCancel.restype = c_.c_int
+        c_lib.jb_futureCancel(c_.c_void_p(self.c_future))
+
+    # Waits for the construction and returns the Player, None if it failed or was cancelled
+    def player(self):
+        if self.taken is None and self.wait() == FutureStatus.READY:
+            c_lib.jb_futureTakePlayer.restype = c_.c_void_p
+            self.taken = Player(self.type, self.rules, c_lib.jb_futureTakePlayer(c_.c_void_p(self.c_future)))
+        return self.taken
 
 def applyActions(p0, p1, s0, s1, a0, a1):
     c_lib.jb_applyActions.restype = c_.c_int
@@ -108,46 +323,99 @@ def applyActions(p0, p1, s0, s1, a0, a1):
     if rc < 0:
         raise Exception("error while applying action")
 
+# Plays the games inside the library. Returns a Counter with the same keys as playGame
+# (0 and 1 for wins of p0 and p1, -1 for draws), and the list of turns per game if asked for.
+# With lockstep > 0, that many games run side by side and each player decides for all of them
+# in one call per turn, which is what a ForeignPlayer needs.
+def playGames(p0, p1, games, allowLearning0=False, allowLearning1=False, withTurns=False, lockstep=0):
+    result = MatchResult()
+    turns = (c_.c_int * games)() if withTurns else None
+    if lockstep > 0:
+        c_lib.jb_playGamesLockstep.restype = c_.c_int
+        ec = c_lib.jb_playGamesLockstep(c_.c_void_p(p0.c_player), c_.c_void_p(p1.c_player), c_.c_int(games), c_.c_int(lockstep), \
+                                        c_.c_int(allowLearning0), c_.c_int(allowLearning1), c_.byref(result), turns)
+    else:
+        c_lib.jb_playGames.restype = c_.c_int
+        ec = c_lib.jb_playGames(c_.c_void_p(p0.c_player), c_.c_void_p(p1.c_player), c_.c_int(games), \
+                                c_.c_int(allowLearning0), c_.c_int(allowLearning1), c_.byref(result), turns)
+    if ec < 0:
+        raise JBException(ec)
+    c = Counter({0: result.winsA, 1: result.winsB, -1: result.ties})
+    if withTurns:
+        return c, list(turns)
+    return c
+
+# Same as applyActions on State values, updated in place
+def applyActionsToStates(rules, s0, s1, a0, a1):
+    ec = c_lib.jb_applyActionsToStates(c_.c_void_p(rules.c_rules), c_.byref(s0), c_.byref(s1), a0.value, a1.value)
+    if ec < 0:
+        raise JBException(ec)
+
+# Hot-path counters of the library, see include/counters.h. All zeros unless it was built with JAMESBOND_COUNTERS.
+def countersEnabled():
+    c_lib.jb_countersEnabled.restype = c_.c_int
+    return c_lib.jb_countersEnabled() != 0
+
+# Dict from counter name to its sum over all threads since the last resetCounters
+def counters():
+    c_lib.jb_counterName.restype = c_.c_char_p
+    names = []
+    while True:
+        name = c_lib.jb_counterName(c_.c_int(len(names)))
+        if name is None:
+            break
+        names.append(name.decode())
+    values = (c_.c_ulonglong * len(names))()
+    c_lib.jb_readCounters.restype = c_.c_int
+    ec = c_lib.jb_readCounters(values, c_.c_int(len(names)))
+    if ec < 0:
+        raise JBException(ec)
+    return dict(zip(names, values))
+
+def resetCounters():
+    c_lib.jb_resetCounters.restype = None
+    c_lib.jb_resetCounters()
+
+# Plays one game turn by turn from Python: 0 or 1 for a win of p0 or p1, -1 for a draw, as playGames
 def playGame(p0, p1, rules):
-    s0 = PlayerState(rules.startLives, 0, 0)
-    s1 = PlayerState(rules.startLives, 0, 0)
+    s0 = State(rules.startLives, 0, rules.maxRemainingShields)
+    s1 = State(rules.startLives, 0, rules.maxRemainingShields)
 
-    max_turns = 1000
     turns = 0
-    while s0.lives() > 0 and s1.lives() > 0 and turns < max_turns:
+    while s0.lives > 0 and s1.lives > 0 and turns < rules.maxTurns:
         turns += 1
 
-        # print("{} {} {}".format(s0.lives(), s0.bullets(), s0.remainingShields()))
-        # print("{} {} {}".format(s1.lives(), s1.bullets(), s1.remainingShields()))
+        # print("{} {} {}".format(s0.lives, s0.bullets, s0.remainingShields))
+        # print("{} {} {}".format(s1.lives, s1.bullets, s1.remainingShields))
 
-        a0 = p0.play(s0, s1, rules)
-        a1 = p1.play(s1, s0, rules)
+        a0 = p0.playState(s0, s1)
+        a1 = p1.playState(s1, s0)
 
         # print("Player 0 plays {}".format(a0))
         # print("Player 1 plays {}".format(a1))
 
-        applyActions(p0, p1, s0, s1, a0, a1)
+        applyActionsToStates(rules, s0, s1, a0, a1)
 
     verbose = False
-    if turns >= max_turns or (s0.lives() == 0 and s1.lives() == 0):
+    if s0.lives > 0 and s1.lives > 0:
+        # Stopped at rules.maxTurns, decided as GameState::winner: lives, then bullets, then remaining shields
+        key0 = (s0.lives, s0.bullets, s0.remainingShields)
+        key1 = (s1.lives, s1.bullets, s1.remainingShields)
+        if verbose:
+            print("Turn limit, p0: {} p1: {}".format(key0, key1))
+        return 0 if key0 > key1 else 1 if key1 > key0 else -1
+    elif s0.lives <= 0 and s1.lives <= 0:
         if verbose:
             print("Draw")
         return -1
-    elif s0.lives() > 0 and s1.lives() == 0:
+    elif s0.lives > 0:
         if verbose:
             print("Player 0 wins")
         return 0
-    elif s0.lives() == 0 and s1.lives() > 0:
+    else:
         if verbose:
             print("Player 1 wins")
         return 1
-    else:
-        if verbose:
-            print("what ?")
-            print("turns=", turns)
-            print("p0: lives={} bullets={} shields={}", s0.lives(), s0.bullets(), s0.remainingShields())
-            print("p1: lives={} bullets={} shields={}", s1.lives(), s1.bullets(), s1.remainingShields())
-        return -2
 
 if __name__ == "__main__":
     rules = Rules(5, 5, 5)
@@ -158,26 +426,16 @@ if __name__ == "__main__":
     p3 = Player(PlayerType.SHAPLEY, rules)
 
     if True:
-        games = []
-        for _ in range(1000):
-            res = playGame(p0, p1, rules)
-            games.append(res)
+        c = playGames(p0, p1, 1000)
 
-        c = Counter(games)
-        
         print("player random   won {} times".format(c[0]))
         print("player qlearner won {} times".format(c[1]))
         print("draws {}".format(c[-1]))
 
 
     if True:
-        games = []
-        for _ in range(1000):
-            res = playGame(p2, p3, rules)
-            games.append(res)
+        c = playGames(p2, p3, 1000)
 
-        c = Counter(games)
-        
         print("player bilinear won {} times".format(c[0]))
         print("player shapley won {} times".format(c[1]))
         print("draws {}".format(c[-1]))